@@ -0,0 +1,490 @@
+// Микробенчмарки операций SearchServer на синтетических корпусах разного размера.
+//
+// Каждый результат - отдельная строка JSON (JSON Lines) в стандартном выводе, например:
+//   {"name":"FindTopDocuments/par/status","documents":10000,"query_words":4,"minus_ratio":0.25,
+//    "operations":100,"repetitions":5,"min_ns_per_op":...,"median_ns_per_op":...,"mean_ns_per_op":...,"checksum":...}
+// checksum зависит только от результатов операций: при одинаковых параметрах он не должен меняться между версиями.
+//
+// Сборка из каталога search-server:
+//   g++ -std=c++17 -O2 -I. benchmark/search_server_benchmark.cpp $(ls *.cpp | grep -v main.cpp) -ltbb -lpthread
+//
+// Параметры (значения по умолчанию):
+//   --sizes=1000,10000,100000   размеры корпуса
+//   --query-words=1,4,16        число слов в запросе
+//   --minus-ratios=0,0.25       вероятность того, что слово запроса - минус-слово
+//   --queries=100               запросов (операций) в одном замере
+//   --repetitions=5             число замеров; в отчёт попадают минимум, медиана и среднее
+//   --filter=<подстрока>        запускать только бенчмарки, в имени которых есть подстрока
+//   --baseline=<файл>           сравнить медианы с результатами прошлого прогона из файла
+//   --tolerance=0.1             допустимое замедление относительно baseline; при большем код возврата 1
+//   --metrics                   после замеров вывести в std::cerr счётчики и гистограммы этапов (stage_metrics.h)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <execution>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "near_duplicates.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+#include "stage_metrics.h"
+
+using namespace std::literals;
+
+namespace {
+struct Options {
+    std::vector<size_t> sizes = { 1000, 10000, 100000 };
+    std::vector<size_t> query_words = { 1, 4, 16 };
+    std::vector<double> minus_ratios = { 0.0, 0.25 };
+    size_t queries = 100;
+    size_t repetitions = 5;
+    std::string filter;
+    std::string baseline;
+    double tolerance = 0.1;
+    bool print_metrics = false;
+};
+
+// Параметры замера в порядке вывода: имя параметра -> значение в виде JSON
+using Params = std::vector<std::pair<std::string, std::string>>;
+
+const size_t DICTIONARY_SIZE = 20000;
+const size_t DOCUMENT_WORDS = 40;
+const int DUPLICATE_PERIOD = 10; //в корпусе для RemoveDuplicates каждый 10-й документ - перестановка предыдущего
+
+std::string ToJson(double value) {
+    std::ostringstream out;
+    out << std::setprecision(10) << value;
+    return out.str();
+}
+
+std::string GenerateWord(std::mt19937& generator, int max_length) {
+    const int length = std::uniform_int_distribution(1, max_length)(generator);
+    std::string word;
+    word.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        word.push_back(static_cast<char>(std::uniform_int_distribution(0, 25)(generator) + 'a'));
+    }
+    return word;
+}
+
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, size_t word_count, int max_length) {
+    std::vector<std::string> words;
+    words.reserve(word_count);
+    for (size_t i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    std::shuffle(words.begin(), words.end(), generator);
+    return words;
+}
+
+// Частоты слов убывают примерно как в естественном языке: первые слова словаря встречаются намного чаще последних
+const std::string& PickWord(std::mt19937& generator, const std::vector<std::string>& dictionary) {
+    const double u = std::uniform_real_distribution<>(0.0, 1.0)(generator);
+    return dictionary[std::min(dictionary.size() - 1, static_cast<size_t>(u * u * u * dictionary.size()))];
+}
+
+std::string GenerateText(std::mt19937& generator, const std::vector<std::string>& dictionary, size_t word_count,
+    double minus_ratio = 0.0) {
+    std::string text;
+    for (size_t i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        if (std::uniform_real_distribution<>(0.0, 1.0)(generator) < minus_ratio) {
+            text.push_back('-');
+        }
+        text += PickWord(generator, dictionary);
+    }
+    return text;
+}
+
+DocumentStatus GetStatus(int document_id) {
+    // 90% документов актуальны, остальные поровну распределены между другими статусами
+    switch (document_id % 30) {
+    case 0: return DocumentStatus::IRRELEVANT;
+    case 1: return DocumentStatus::BANNED;
+    case 2: return DocumentStatus::REMOVED;
+    default: return DocumentStatus::ACTUAL;
+    }
+}
+
+std::vector<int> GetRatings(int document_id) {
+    return { document_id % 10 - 3, document_id % 7 };
+}
+
+struct Corpus {
+    std::vector<std::string> dictionary;
+    std::vector<std::string> documents;
+};
+
+Corpus GenerateCorpus(size_t document_count) {
+    std::mt19937 generator(static_cast<uint32_t>(document_count));
+    Corpus corpus;
+    corpus.dictionary = GenerateDictionary(generator, DICTIONARY_SIZE, 12);
+    corpus.documents.reserve(document_count);
+    for (size_t i = 0; i < document_count; ++i) {
+        corpus.documents.push_back(GenerateText(generator, corpus.dictionary, DOCUMENT_WORDS));
+    }
+    return corpus;
+}
+
+std::vector<std::string> GenerateQueries(const Corpus& corpus, size_t query_count, size_t word_count, double minus_ratio) {
+    std::mt19937 generator(static_cast<uint32_t>(word_count * 1000 + minus_ratio * 100));
+    std::vector<std::string> queries;
+    queries.reserve(query_count);
+    for (size_t i = 0; i < query_count; ++i) {
+        queries.push_back(GenerateText(generator, corpus.dictionary, word_count, minus_ratio));
+    }
+    return queries;
+}
+
+std::unique_ptr<SearchServer> BuildServer(const Corpus& corpus) {
+    auto server = std::make_unique<SearchServer>(corpus.dictionary.front());
+    std::vector<DocumentInput> inputs;
+    inputs.reserve(corpus.documents.size());
+    for (size_t i = 0; i < corpus.documents.size(); ++i) {
+        const int id = static_cast<int>(i);
+        inputs.push_back({ id, corpus.documents[i], GetStatus(id), GetRatings(id) });
+    }
+    server->AddDocuments(inputs);
+    return server;
+}
+
+double SumRelevance(const std::vector<Document>& documents) {
+    double sum = 0.0;
+    for (const Document& document : documents) {
+        sum += document.relevance + document.id;
+    }
+    return sum;
+}
+
+class BenchmarkRunner {
+public:
+    explicit BenchmarkRunner(const Options& options) :
+            options_(options) {
+        if (!options_.baseline.empty()) {
+            LoadBaseline(options_.baseline);
+        }
+    }
+
+    bool IsEnabled(const std::string& name) const {
+        return name.find(options_.filter) != std::string::npos;
+    }
+
+    // setup готовит состояние замера и не входит во время; run выполняет operations операций
+    // и возвращает контрольную сумму их результатов
+    template <typename Setup, typename Run>
+    void Measure(const std::string& name, const Params& params, size_t operations, Setup setup, Run run) {
+        if (!IsEnabled(name) || operations == 0) {
+            return;
+        }
+        std::vector<double> ns_per_op;
+        double checksum = 0.0;
+        // Первый прогон прогревает кэши и пул потоков и в отчёт не попадает
+        for (size_t repetition = 0; repetition <= options_.repetitions; ++repetition) {
+            setup();
+            const auto start = std::chrono::steady_clock::now();
+            checksum = run();
+            const auto finish = std::chrono::steady_clock::now();
+            if (repetition > 0) {
+                ns_per_op.push_back(std::chrono::duration<double, std::nano>(finish - start).count() / operations);
+            }
+        }
+        Report(name, params, operations, ns_per_op, checksum);
+    }
+
+    // Возвращает 1, если какой-либо бенчмарк медленнее baseline больше допустимого
+    int Finish() const {
+        for (const std::string& regression : regressions_) {
+            std::cerr << "Regression: "s << regression << std::endl;
+        }
+        return regressions_.empty() ? 0 : 1;
+    }
+private:
+    const Options& options_;
+    std::map<std::string, double> baseline_; //имя и параметры замера -> медиана нс на операцию
+    std::vector<std::string> regressions_;
+
+    void Report(const std::string& name, const Params& params, size_t operations, std::vector<double> ns_per_op,
+        double checksum) {
+        std::sort(ns_per_op.begin(), ns_per_op.end());
+        const double median = ns_per_op.size() % 2 == 1 ? ns_per_op[ns_per_op.size() / 2]
+            : (ns_per_op[ns_per_op.size() / 2 - 1] + ns_per_op[ns_per_op.size() / 2]) / 2;
+        const double mean = std::accumulate(ns_per_op.begin(), ns_per_op.end(), 0.0) / ns_per_op.size();
+
+        std::string key = "{\"name\":\""s + name + "\""s;
+        for (const auto& [param, value] : params) {
+            key += ",\""s + param + "\":"s + value;
+        }
+        std::cout << key << ",\"operations\":"s << operations << ",\"repetitions\":"s << ns_per_op.size()
+            << ",\"min_ns_per_op\":"s << ToJson(ns_per_op.front()) << ",\"median_ns_per_op\":"s << ToJson(median)
+            << ",\"mean_ns_per_op\":"s << ToJson(mean) << ",\"checksum\":"s << ToJson(checksum) << "}"s << std::endl;
+
+        const auto it = baseline_.find(key);
+        if (it != baseline_.end() && median > it->second * (1.0 + options_.tolerance)) {
+            regressions_.push_back(key + "} "s + ToJson(it->second) + " -> "s + ToJson(median) + " ns/op"s);
+        }
+    }
+
+    // Строки baseline записаны этой же программой: ключ - всё до поля operations
+    void LoadBaseline(const std::string& path) {
+        std::ifstream input(path);
+        if (!input) {
+            throw std::invalid_argument("Can't open baseline file "s + path);
+        }
+        const std::string median_field = "\"median_ns_per_op\":"s;
+        std::string line;
+        while (std::getline(input, line)) {
+            const size_t key_end = line.find(",\"operations\":"s);
+            const size_t median_begin = line.find(median_field);
+            if (key_end == std::string::npos || median_begin == std::string::npos) {
+                continue;
+            }
+            baseline_[line.substr(0, key_end)] = std::stod(line.substr(median_begin + median_field.size()));
+        }
+    }
+};
+
+void RunAddBenchmarks(BenchmarkRunner& runner, const Corpus& corpus) {
+    const Params params = { { "documents"s, std::to_string(corpus.documents.size()) } };
+    std::unique_ptr<SearchServer> server;
+    const auto reset = [&server, &corpus]() { server = std::make_unique<SearchServer>(corpus.dictionary.front()); };
+
+    runner.Measure("AddDocument"s, params, corpus.documents.size(), reset, [&server, &corpus]() {
+        for (size_t i = 0; i < corpus.documents.size(); ++i) {
+            const int id = static_cast<int>(i);
+            server->AddDocument(id, corpus.documents[i], GetStatus(id), GetRatings(id));
+        }
+        return static_cast<double>(server->GetDocumentCount());
+        });
+
+    std::vector<DocumentInput> inputs;
+    for (size_t i = 0; i < corpus.documents.size(); ++i) {
+        const int id = static_cast<int>(i);
+        inputs.push_back({ id, corpus.documents[i], GetStatus(id), GetRatings(id) });
+    }
+    runner.Measure("AddDocuments"s, params, corpus.documents.size(), reset, [&server, &inputs]() {
+        server->AddDocuments(inputs);
+        return static_cast<double>(server->GetDocumentCount());
+        });
+}
+
+void RunQueryBenchmarks(BenchmarkRunner& runner, const Options& options, const Corpus& corpus, SearchServer& server) {
+    const auto no_setup = []() {};
+    const auto is_actual = [](int, DocumentStatus status, int) { return status == DocumentStatus::ACTUAL; };
+    const int document_count = static_cast<int>(corpus.documents.size());
+
+    for (const size_t word_count : options.query_words) {
+        for (const double minus_ratio : options.minus_ratios) {
+            const std::vector<std::string> queries = GenerateQueries(corpus, options.queries, word_count, minus_ratio);
+            const Params params = { { "documents"s, std::to_string(corpus.documents.size()) },
+                { "query_words"s, std::to_string(word_count) }, { "minus_ratio"s, ToJson(minus_ratio) } };
+            const auto find_all = [&queries](auto find) {
+                return [&queries, find]() {
+                    double checksum = 0.0;
+                    for (const std::string& query : queries) {
+                        checksum += SumRelevance(find(query));
+                    }
+                    return checksum;
+                };
+            };
+
+            runner.Measure("FindTopDocuments/seq/status"s, params, queries.size(), no_setup,
+                find_all([&server](const std::string& query) {
+                    return server.FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL); }));
+            runner.Measure("FindTopDocuments/par/status"s, params, queries.size(), no_setup,
+                find_all([&server](const std::string& query) {
+                    return server.FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL); }));
+            runner.Measure("FindTopDocuments/seq/predicate"s, params, queries.size(), no_setup,
+                find_all([&server, is_actual](const std::string& query) {
+                    return server.FindTopDocuments(std::execution::seq, query, is_actual); }));
+            runner.Measure("FindTopDocuments/par/predicate"s, params, queries.size(), no_setup,
+                find_all([&server, is_actual](const std::string& query) {
+                    return server.FindTopDocuments(std::execution::par, query, is_actual); }));
+            runner.Measure("FindTopDocuments/seq/status/max_score"s, params, queries.size(),
+                [&server]() { server.SetRetrievalMode(RetrievalMode::MAX_SCORE); },
+                find_all([&server](const std::string& query) {
+                    return server.FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL); }));
+            server.SetRetrievalMode(RetrievalMode::EXHAUSTIVE);
+
+            const auto match_all = [&queries, document_count](auto match) {
+                return [&queries, document_count, match]() {
+                    double checksum = 0.0;
+                    for (size_t i = 0; i < queries.size(); ++i) {
+                        const int document_id = static_cast<int>((i * 7919) % document_count);
+                        checksum += static_cast<double>(std::get<0>(match(queries[i], document_id)).size());
+                    }
+                    return checksum;
+                };
+            };
+            runner.Measure("MatchDocument/seq"s, params, queries.size(), no_setup,
+                match_all([&server](const std::string& query, int document_id) {
+                    return server.MatchDocument(std::execution::seq, query, document_id); }));
+            runner.Measure("MatchDocument/par"s, params, queries.size(), no_setup,
+                match_all([&server](const std::string& query, int document_id) {
+                    return server.MatchDocument(std::execution::par, query, document_id); }));
+
+            runner.Measure("ProcessQueries"s, params, queries.size(), no_setup, [&server, &queries]() {
+                double checksum = 0.0;
+                for (const std::vector<Document>& documents : ProcessQueries(server, queries)) {
+                    checksum += SumRelevance(documents);
+                }
+                return checksum;
+                });
+            runner.Measure("ProcessQueriesJoined"s, params, queries.size(), no_setup, [&server, &queries]() {
+                const JoinedResults results = ProcessQueriesJoined(server, queries);
+                return SumRelevance(std::vector<Document>(results.begin(), results.end()));
+                });
+        }
+    }
+}
+
+void RunRemoveBenchmarks(BenchmarkRunner& runner, const Options& options, const Corpus& corpus) {
+    const Params params = { { "documents"s, std::to_string(corpus.documents.size()) } };
+    // Удаляется каждый k-й документ, всего не больше options.queries * 10 документов
+    const size_t remove_count = std::min(corpus.documents.size(), options.queries * 10);
+    const size_t step = corpus.documents.size() / remove_count;
+    std::unique_ptr<SearchServer> server;
+    const auto rebuild = [&server, &corpus]() { server = BuildServer(corpus); };
+    const auto remove_all = [&server, remove_count, step](auto remove) {
+        return [&server, remove_count, step, remove]() {
+            for (size_t i = 0; i < remove_count; ++i) {
+                remove(*server, static_cast<int>(i * step));
+            }
+            return static_cast<double>(server->GetDocumentCount());
+        };
+    };
+    runner.Measure("RemoveDocument/seq"s, params, remove_count, rebuild, remove_all([](SearchServer& target, int id) {
+        target.RemoveDocument(std::execution::seq, id); }));
+    runner.Measure("RemoveDocument/par"s, params, remove_count, rebuild, remove_all([](SearchServer& target, int id) {
+        target.RemoveDocument(std::execution::par, id); }));
+    runner.Measure("RemoveDocuments"s, params, remove_count, rebuild, [&server, remove_count, step]() {
+        std::vector<int> ids(remove_count);
+        for (size_t i = 0; i < remove_count; ++i) {
+            ids[i] = static_cast<int>(i * step);
+        }
+        server->RemoveDocuments(ids);
+        return static_cast<double>(server->GetDocumentCount());
+        });
+
+    if (!runner.IsEnabled("RemoveDuplicates"s) && !runner.IsEnabled("FindNearDuplicates"s)) {
+        return;
+    }
+    // Каждый DUPLICATE_PERIOD-й документ состоит из тех же слов, что и предыдущий, в другом порядке
+    std::vector<std::string> texts = corpus.documents;
+    std::mt19937 generator(1);
+    for (size_t i = DUPLICATE_PERIOD; i < texts.size(); i += DUPLICATE_PERIOD) {
+        std::vector<std::string> words = SplitIntoWords(texts[i - 1]);
+        std::shuffle(words.begin(), words.end(), generator);
+        texts[i].clear();
+        for (const std::string& word : words) {
+            texts[i] += word + " "s;
+        }
+    }
+    const Corpus duplicated{ corpus.dictionary, std::move(texts) };
+    const auto rebuild_duplicated = [&server, &duplicated]() { server = BuildServer(duplicated); };
+    runner.Measure("RemoveDuplicates"s, params, corpus.documents.size(), rebuild_duplicated, [&server]() {
+        RemoveDuplicates(*server);
+        return static_cast<double>(server->GetDocumentCount());
+        });
+    runner.Measure("FindNearDuplicates"s, params, corpus.documents.size(), rebuild_duplicated, [&server]() {
+        return static_cast<double>(FindNearDuplicates(*server).size());
+        });
+}
+
+template <typename T>
+std::vector<T> ParseList(const std::string& text) {
+    std::vector<T> values;
+    std::istringstream input(text);
+    std::string item;
+    while (std::getline(input, item, ',')) {
+        std::istringstream item_input(item);
+        T value;
+        if (!(item_input >> value)) {
+            throw std::invalid_argument("Invalid list value "s + item);
+        }
+        values.push_back(value);
+    }
+    return values;
+}
+
+Options ParseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        const size_t separator = argument.find('=');
+        const std::string name = argument.substr(0, separator);
+        const std::string value = separator == std::string::npos ? ""s : argument.substr(separator + 1);
+        if (name == "--sizes"s) {
+            options.sizes = ParseList<size_t>(value);
+        }
+        else if (name == "--query-words"s) {
+            options.query_words = ParseList<size_t>(value);
+        }
+        else if (name == "--minus-ratios"s) {
+            options.minus_ratios = ParseList<double>(value);
+        }
+        else if (name == "--queries"s) {
+            options.queries = std::stoul(value);
+        }
+        else if (name == "--repetitions"s) {
+            options.repetitions = std::max<size_t>(1, std::stoul(value));
+        }
+        else if (name == "--filter"s) {
+            options.filter = value;
+        }
+        else if (name == "--baseline"s) {
+            options.baseline = value;
+        }
+        else if (name == "--tolerance"s) {
+            options.tolerance = std::stod(value);
+        }
+        else if (name == "--metrics"s) {
+            options.print_metrics = true;
+        }
+        else {
+            throw std::invalid_argument("Unknown option "s + argument);
+        }
+    }
+    return options;
+}
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options options = ParseOptions(argc, argv);
+        BenchmarkRunner runner(options);
+        for (const size_t size : options.sizes) {
+            if (size == 0) {
+                continue;
+            }
+            const Corpus corpus = GenerateCorpus(size);
+            RunAddBenchmarks(runner, corpus);
+            const std::unique_ptr<SearchServer> server = BuildServer(corpus);
+            RunQueryBenchmarks(runner, options, corpus, *server);
+            RunRemoveBenchmarks(runner, options, corpus);
+        }
+        if (options.print_metrics) {
+            PrintMetrics(std::cerr);
+        }
+        return runner.Finish();
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+}
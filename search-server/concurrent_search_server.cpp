@@ -0,0 +1,114 @@
+#include "concurrent_search_server.h"
+#include <thread>
+
+ConcurrentSearchServer::ConcurrentSearchServer(const std::string& stop_words) :
+        replicas_{ SearchServer(stop_words), SearchServer(stop_words) } {
+    }
+
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+    size_t top_k) const {
+    return Read([&](const SearchServer& server) { return server.FindTopDocuments(raw_query, status, top_k); });
+}
+
+std::tuple<std::vector<std::string>, DocumentStatus> ConcurrentSearchServer::MatchDocument(std::string_view raw_query,
+    int document_id) const {
+    return Read([&](const SearchServer& server) {
+        const auto [words, status] = server.MatchDocument(raw_query, document_id);
+        return std::tuple<std::vector<std::string>, DocumentStatus>(
+            std::vector<std::string>(words.begin(), words.end()), status);
+        });
+}
+
+size_t ConcurrentSearchServer::GetDocumentCount() const {
+    return Read([](const SearchServer& server) { return server.GetDocumentCount(); });
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+    const std::vector<int>& ratings) {
+    Update([document_id, text = std::string(document), status, ratings](SearchServer& server) {
+        server.AddDocument(document_id, text, status, ratings);
+        });
+}
+
+void ConcurrentSearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    // Изменение хранится в журнале до применения ко второй копии, поэтому тексты копируются
+    std::vector<std::string> texts;
+    texts.reserve(documents.size());
+    for (const DocumentInput& document : documents) {
+        texts.emplace_back(document.text);
+    }
+    Update([texts = std::move(texts), documents](SearchServer& server) {
+        std::vector<DocumentInput> inputs = documents;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            inputs[i].text = texts[i];
+        }
+        server.AddDocuments(inputs);
+        });
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    // Читатели не выносят ссылок на слова копии (MatchDocument копирует слова), поэтому память удалённых слов
+    // можно возвращать сразу
+    Update([document_id](SearchServer& server) {
+        server.RemoveDocument(document_id);
+        server.CompactTerms();
+        });
+}
+
+void ConcurrentSearchServer::Update(std::function<void(SearchServer&)> operation) {
+    std::lock_guard<std::mutex> guard(write_mutex_);
+    const size_t standby = 1 - active_.load(std::memory_order_relaxed);
+    // Неактивная копия до последнего переключения была активной: сначала из неё должны выйти читатели
+    WaitForReaders(standby);
+    try {
+        for (const auto& pending : pending_) {
+            pending(replicas_[standby]);
+        }
+        pending_.clear();
+        operation(replicas_[standby]);
+    }
+    catch (...) {
+        // Активная копия уже содержит все изменения из журнала, поэтому после пересборки журнал пуст
+        pending_.clear();
+        replicas_[standby] = replicas_[1 - standby].Clone();
+        throw;
+    }
+    pending_.push_back(std::move(operation));
+    active_.store(standby, std::memory_order_seq_cst);
+}
+
+size_t ConcurrentSearchServer::GetReaderStripe() {
+    thread_local const size_t stripe = std::hash<std::thread::id>{}(std::this_thread::get_id()) % READER_STRIPES;
+    return stripe;
+}
+
+void ConcurrentSearchServer::WaitForReaders(size_t replica) const {
+    for (const ReaderCounter& counter : readers_[replica]) {
+        while (counter.count.load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+ConcurrentSearchServer::ReadGuard::ReadGuard(const ConcurrentSearchServer& server) :
+        owner_(server) {
+    const size_t stripe = GetReaderStripe();
+    for (;;) {
+        replica_ = owner_.active_.load(std::memory_order_seq_cst);
+        counter_ = &owner_.readers_[replica_][stripe];
+        counter_->count.fetch_add(1, std::memory_order_seq_cst);
+        // Если писатель успел переключить копию, он может уже не ждать этого читателя: нужно войти заново
+        if (owner_.active_.load(std::memory_order_seq_cst) == replica_) {
+            return;
+        }
+        counter_->count.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
+
+ConcurrentSearchServer::ReadGuard::~ReadGuard() {
+    counter_->count.fetch_sub(1, std::memory_order_release);
+}
+
+const SearchServer& ConcurrentSearchServer::ReadGuard::GetServer() const {
+    return owner_.replicas_[replica_];
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include "search_server.h"
+
+// Поисковый сервер, который можно читать из любого числа потоков во время изменения базы.
+// Хранит две копии индекса (схема left-right): читатели без блокировок работают с активной копией,
+// писатель изменяет неактивную, делает её активной и дожидается, пока из прежней выйдут все читатели.
+// Изменение, ещё не применённое к прежней копии, хранится в журнале и применяется к ней при следующей записи
+class ConcurrentSearchServer {
+public:
+    template <typename StringContainer>
+    explicit ConcurrentSearchServer(const StringContainer& stop_words);
+
+    explicit ConcurrentSearchServer(const std::string& stop_words);
+
+    ConcurrentSearchServer(const ConcurrentSearchServer&) = delete;
+    ConcurrentSearchServer& operator=(const ConcurrentSearchServer&) = delete;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+        size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <typename Predicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, Predicate predicate,
+        size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Найденные слова копируются: после выхода из копии индекса она может быть изменена писателем
+    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    size_t GetDocumentCount() const;
+
+    // Выполняет reader(const SearchServer&) над активной копией; ссылки на её данные недействительны после возврата
+    template <typename Reader>
+    auto Read(Reader reader) const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void AddDocuments(const std::vector<DocumentInput>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // Применяет к базе произвольное изменение. Оно выполняется отдельно для каждой копии и должно давать одинаковый результат.
+    // Если изменение бросает исключение, база не меняется, а исключение передаётся вызывающему: изменение могло
+    // частично примениться к неактивной копии, поэтому она пересобирается из активной (SearchServer::Clone)
+    void Update(std::function<void(SearchServer&)> operation);
+private:
+    static constexpr size_t READER_STRIPES = 16;
+
+    // Счётчики читателей разнесены по разным кэш-линиям, чтобы потоки не мешали друг другу
+    struct alignas(64) ReaderCounter {
+        std::atomic<int64_t> count = 0;
+    };
+
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const ConcurrentSearchServer& server);
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        ~ReadGuard();
+
+        const SearchServer& GetServer() const;
+    private:
+        const ConcurrentSearchServer& owner_;
+        ReaderCounter* counter_ = nullptr;
+        size_t replica_ = 0;
+    };
+
+    std::array<SearchServer, 2> replicas_;
+    std::atomic<size_t> active_ = 0; //копия, с которой работают читатели
+    mutable std::array<std::array<ReaderCounter, READER_STRIPES>, 2> readers_;
+    std::mutex write_mutex_;
+    std::vector<std::function<void(SearchServer&)>> pending_; //изменения, ещё не применённые к неактивной копии
+
+    static size_t GetReaderStripe();
+
+    void WaitForReaders(size_t replica) const;
+};
+
+template <typename StringContainer>
+ConcurrentSearchServer::ConcurrentSearchServer(const StringContainer& stop_words) :
+        replicas_{ SearchServer(stop_words), SearchServer(stop_words) } {
+    }
+
+template <typename Predicate>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query, Predicate predicate,
+    size_t top_k) const {
+    return Read([&](const SearchServer& server) { return server.FindTopDocuments(raw_query, predicate, top_k); });
+}
+
+template <typename Reader>
+auto ConcurrentSearchServer::Read(Reader reader) const {
+    ReadGuard guard(*this);
+    return reader(guard.GetServer());
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <iostream>
 
 struct Document {
@@ -18,4 +19,6 @@ enum class DocumentStatus {
     IRRELEVANT,
     BANNED,
     REMOVED,
-};
\ No newline at end of file
+};
+
+const size_t DOCUMENT_STATUS_COUNT = 4;
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "document_stream.h"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "bounded_queue.h"
+#include "snapshot.h"
+
+namespace {
+// Пакет записей вместе с памятью, в которой лежат их тексты
+struct RecordBatch {
+    std::vector<std::shared_ptr<const void>> storages;
+    std::vector<DocumentInput> documents;
+};
+
+struct PreparedBatch {
+    std::vector<std::shared_ptr<const void>> storages;
+    std::vector<SearchServer::PreparedDocument> documents;
+};
+
+// Собирает записи в пакеты и отправляет их на разбор
+class BatchBuilder {
+public:
+    BatchBuilder(const DocumentStreamOptions& options, BoundedQueue<RecordBatch>& queue) :
+            options_(options),
+            queue_(queue),
+            next_document_id_(options.first_document_id) {
+        Reset();
+    }
+
+    // Делит data на записи и возвращает длину хвоста, не завершённого разделителем.
+    // Если is_last, хвост тоже считается записью
+    size_t AddRecords(const std::shared_ptr<const void>& storage, std::string_view data, bool is_last) {
+        size_t pos = 0;
+        while (pos < data.size() && !stopped_) {
+            const void* found = std::memchr(data.data() + pos, options_.delimiter, data.size() - pos);
+            if (found == nullptr) {
+                break;
+            }
+            const size_t end = static_cast<const char*>(found) - data.data();
+            AddRecord(storage, data.substr(pos, end - pos));
+            pos = end + 1;
+        }
+        if (is_last && pos < data.size() && !stopped_) {
+            AddRecord(storage, data.substr(pos));
+            pos = data.size();
+        }
+        return data.size() - pos;
+    }
+
+    void Flush() {
+        if (batch_.documents.empty() || stopped_) {
+            return;
+        }
+        stopped_ = !queue_.Push(std::move(batch_));
+        Reset();
+    }
+
+    // Очередь закрыта из-за ошибки на другой стадии, и читать дальше незачем
+    bool IsStopped() const {
+        return stopped_;
+    }
+private:
+    const DocumentStreamOptions& options_;
+    BoundedQueue<RecordBatch>& queue_;
+    int next_document_id_;
+    RecordBatch batch_;
+    bool stopped_ = false;
+
+    void AddRecord(const std::shared_ptr<const void>& storage, std::string_view record) {
+        if (options_.delimiter == '\n' && !record.empty() && record.back() == '\r') {
+            record.remove_suffix(1);
+        }
+        if (batch_.storages.empty() || batch_.storages.back() != storage) {
+            batch_.storages.push_back(storage);
+        }
+        batch_.documents.push_back({ next_document_id_++, record, options_.status, options_.ratings });
+        if (batch_.documents.size() >= std::max<size_t>(options_.batch_size, 1)) {
+            Flush();
+        }
+    }
+
+    void Reset() {
+        batch_ = {};
+        batch_.documents.reserve(std::max<size_t>(options_.batch_size, 1));
+    }
+};
+
+// Запускает стадии разбора и добавления; read_records выполняется в отдельном потоке
+// и передаёт записи в BatchBuilder
+template <typename Reader>
+size_t RunIngestPipeline(SearchServer& search_server, const DocumentStreamOptions& options, Reader read_records) {
+    BoundedQueue<RecordBatch> record_batches(options.queue_capacity);
+    BoundedQueue<PreparedBatch> prepared_batches(options.queue_capacity);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    const auto fail = [&]() {
+        {
+            std::lock_guard<std::mutex> guard(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        record_batches.Close();
+        prepared_batches.Close();
+    };
+    const auto failed = [&]() {
+        std::lock_guard<std::mutex> guard(error_mutex);
+        return static_cast<bool>(error);
+    };
+
+    std::thread reader([&]() {
+        try {
+            BatchBuilder builder(options, record_batches);
+            read_records(builder);
+            builder.Flush();
+            record_batches.Close();
+        }
+        catch (...) {
+            fail();
+        }
+        });
+    std::thread tokenizer([&]() {
+        try {
+            while (std::optional<RecordBatch> batch = record_batches.Pop()) {
+                PreparedBatch prepared{ std::move(batch->storages), search_server.PrepareDocuments(batch->documents) };
+                if (!prepared_batches.Push(std::move(prepared))) {
+                    break;
+                }
+            }
+            prepared_batches.Close();
+        }
+        catch (...) {
+            fail();
+        }
+        });
+
+    size_t added_count = 0;
+    try {
+        while (std::optional<PreparedBatch> batch = prepared_batches.Pop()) {
+            if (failed()) {
+                break;
+            }
+            const size_t batch_size = batch->documents.size();
+            search_server.AddDocuments(std::move(batch->documents));
+            added_count += batch_size;
+        }
+    }
+    catch (...) {
+        fail();
+    }
+    reader.join();
+    tokenizer.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return added_count;
+}
+}
+
+size_t AddDocumentsFromStream(SearchServer& search_server, std::istream& input, const DocumentStreamOptions& options) {
+    return RunIngestPipeline(search_server, options, [&input, &options](BatchBuilder& builder) {
+        const size_t read_size = std::max<size_t>(options.read_size, 1);
+        std::string tail;
+        bool is_last = false;
+        while (!is_last) {
+            // Каждый блок начинается с незавершённой записи предыдущего и живёт, пока нужен хотя бы одному пакету
+            auto chunk = std::make_shared<std::string>(std::move(tail));
+            const size_t tail_size = chunk->size();
+            chunk->resize(tail_size + read_size);
+            input.read(chunk->data() + tail_size, static_cast<std::streamsize>(read_size));
+            chunk->resize(tail_size + static_cast<size_t>(input.gcount()));
+            is_last = !input;
+            const size_t rest = builder.AddRecords(chunk, *chunk, is_last);
+            tail.assign(*chunk, chunk->size() - rest, rest);
+            if (builder.IsStopped()) {
+                return;
+            }
+        }
+        });
+}
+
+size_t AddDocumentsFromFile(SearchServer& search_server, const std::string& path, const DocumentStreamOptions& options) {
+    auto file = std::make_shared<const MappedFile>(path);
+    return RunIngestPipeline(search_server, options, [file](BatchBuilder& builder) {
+        builder.AddRecords(file, std::string_view(file->data(), file->size()), true);
+        });
+}
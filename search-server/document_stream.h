@@ -0,0 +1,27 @@
+#pragma once
+#include <istream>
+#include <string>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+
+// Параметры потокового добавления документов: каждая запись входных данных - текст одного документа
+struct DocumentStreamOptions {
+    int first_document_id = 0; //id первой записи; следующие записи получают id по порядку, пустые записи тоже
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    char delimiter = '\n'; //при разделителе '\n' завершающий запись '\r' отбрасывается
+    size_t batch_size = 4096; //записей в одном пакете
+    size_t queue_capacity = 4; //пакетов, ожидающих разбора или добавления
+    size_t read_size = 1 << 22; //байт за одно чтение из std::istream
+};
+
+// Чтение, разбор текстов и пополнение индекса выполняются одновременно в разных потоках,
+// записи передаются между ними пакетами без копирования текста. Возвращает количество добавленных документов.
+// Исключение любой стадии прерывает загрузку и передаётся вызывающему; уже добавленные пакеты остаются в базе
+size_t AddDocumentsFromStream(SearchServer& search_server, std::istream& input,
+    const DocumentStreamOptions& options = {});
+
+// Файл отображается в память, и записи ссылаются прямо на отображение
+size_t AddDocumentsFromFile(SearchServer& search_server, const std::string& path,
+    const DocumentStreamOptions& options = {});
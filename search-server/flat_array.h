@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Непрерывный массив, который либо владеет своими элементами, либо ссылается на чужую память
+// (например, на отображённый в память снимок индекса). При первом изменении чужие данные копируются.
+template <typename T>
+class FlatArray {
+public:
+    FlatArray() = default;
+
+    // Память data должна жить дольше массива
+    static FlatArray Borrow(const T* data, size_t size) {
+        FlatArray result;
+        result.borrowed_ = data;
+        result.borrowed_size_ = size;
+        return result;
+    }
+
+    const T* data() const {
+        return borrowed_ != nullptr ? borrowed_ : owned_.data();
+    }
+
+    size_t size() const {
+        return borrowed_ != nullptr ? borrowed_size_ : owned_.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    const T* begin() const {
+        return data();
+    }
+
+    const T* end() const {
+        return data() + size();
+    }
+
+    const T& operator[](size_t index) const {
+        return data()[index];
+    }
+
+    std::vector<T>& Mutable() {
+        if (borrowed_ != nullptr) {
+            owned_.assign(borrowed_, borrowed_ + borrowed_size_);
+            borrowed_ = nullptr;
+            borrowed_size_ = 0;
+        }
+        return owned_;
+    }
+
+    void ShrinkToFit() {
+        owned_.shrink_to_fit();
+    }
+private:
+    std::vector<T> owned_;
+    const T* borrowed_ = nullptr;
+    size_t borrowed_size_ = 0;
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// IDF слов, вычисленные при последнем обращении. Значение действительно, пока не изменилось поколение индекса
+// (число документов и списки вхождений); устаревшее значение пересчитывается при следующем запросе.
+// Get можно вызывать из нескольких потоков одновременно: потоки одного поколения записывают одно и то же значение
+class IdfCache {
+public:
+    // Новые слова получают невычисленные значения
+    void Resize(size_t term_count) {
+        entries_.resize(term_count);
+    }
+
+    template <typename ComputeIdf>
+    double Get(uint32_t term_id, uint64_t generation, ComputeIdf compute_idf) const {
+        const Entry& entry = entries_[term_id];
+        if (entry.generation.load(std::memory_order_acquire) == generation) {
+            return entry.idf.load(std::memory_order_relaxed);
+        }
+        const double idf = compute_idf();
+        entry.idf.store(idf, std::memory_order_relaxed);
+        entry.generation.store(generation, std::memory_order_release);
+        return idf;
+    }
+private:
+    struct Entry {
+        Entry() = default;
+
+        Entry(const Entry& other) :
+                generation(other.generation.load(std::memory_order_relaxed)),
+                idf(other.idf.load(std::memory_order_relaxed)) {
+        }
+
+        Entry& operator=(const Entry& other) {
+            generation.store(other.generation.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            idf.store(other.idf.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+
+        mutable std::atomic<uint64_t> generation{ UINT64_MAX }; //UINT64_MAX - значение ещё не вычислено
+        mutable std::atomic<double> idf{ 0.0 };
+    };
+
+    std::vector<Entry> entries_;
+};
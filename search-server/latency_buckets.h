@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Логарифмически-линейное разбиение значений на интервалы, как в HDR Histogram.
+// Значения меньше 2 * SUB_BUCKET_COUNT хранятся точно; у больших сохраняются SubBucketBits + 1 старших бит,
+// то есть относительная погрешность не больше 1 / 2^SubBucketBits
+template <int SubBucketBits>
+struct LogLinearBuckets {
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{ 1 } << SubBucketBits;
+    static constexpr size_t COUNT = (64 - SubBucketBits + 1) * SUB_BUCKET_COUNT;
+
+    static size_t GetBucket(uint64_t value) {
+        if (value < 2 * SUB_BUCKET_COUNT) {
+            return static_cast<size_t>(value);
+        }
+#ifdef _MSC_VER
+        unsigned long top_bit;
+        _BitScanReverse64(&top_bit, value);
+#else
+        const int top_bit = 63 - __builtin_clzll(value);
+#endif
+        const int shift = static_cast<int>(top_bit) - SubBucketBits;
+        return static_cast<size_t>(shift * SUB_BUCKET_COUNT + (value >> shift));
+    }
+
+    // Наибольшее значение, попадающее в интервал bucket
+    static uint64_t GetUpperBound(size_t bucket) {
+        const int shift = bucket < 2 * SUB_BUCKET_COUNT ? 0 : static_cast<int>(bucket / SUB_BUCKET_COUNT) - 1;
+        const uint64_t mantissa = bucket - shift * SUB_BUCKET_COUNT;
+        return ((mantissa + 1) << shift) - 1;
+    }
+};
@@ -77,4 +77,6 @@ int main() {
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
     TEST(seq);
     TEST(par);
+    search_server.SetRetrievalMode(RetrievalMode::MAX_SCORE);
+    Test("seq max_score", search_server, queries, execution::seq);
 }
@@ -0,0 +1,225 @@
+#include "near_duplicates.h"
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std::literals;
+
+namespace {
+// Финальное перемешивание SplitMix64
+uint64_t Mix(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+// Семейство хеш-функций h_k(x) = (a_k * x + b_k) >> 32 над перемешанным id слова
+class MinHasher {
+public:
+    MinHasher(size_t hash_count, uint64_t seed) :
+            seed_(Mix(seed)),
+            multipliers_(hash_count),
+            increments_(hash_count) {
+        for (size_t k = 0; k < hash_count; ++k) {
+            multipliers_[k] = Mix(seed_ + 2 * k + 1) | 1;
+            increments_[k] = Mix(seed_ + 2 * k + 2);
+        }
+    }
+
+    // signature - hash_count минимумов h_k по словам документа
+    void ComputeSignature(const std::vector<uint32_t>& term_ids, std::vector<uint32_t>& signature) const {
+        signature.assign(multipliers_.size(), UINT32_MAX);
+        for (const uint32_t term_id : term_ids) {
+            const uint64_t term_hash = Mix(term_id ^ seed_);
+            for (size_t k = 0; k < multipliers_.size(); ++k) {
+                const uint32_t value = static_cast<uint32_t>((multipliers_[k] * term_hash + increments_[k]) >> 32);
+                signature[k] = std::min(signature[k], value);
+            }
+        }
+    }
+
+    uint64_t GetBandHash(const std::vector<uint32_t>& signature, size_t band, size_t rows_per_band) const {
+        uint64_t hash = Mix(seed_ ^ band);
+        for (size_t row = band * rows_per_band; row < (band + 1) * rows_per_band; ++row) {
+            hash = Mix(hash ^ signature[row]);
+        }
+        return hash;
+    }
+private:
+    const uint64_t seed_;
+    std::vector<uint64_t> multipliers_;
+    std::vector<uint64_t> increments_;
+};
+
+// Мера Жаккара отсортированных наборов; у двух пустых наборов она равна 1
+double ComputeJaccard(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs) {
+    size_t intersection = 0;
+    for (auto left = lhs.begin(), right = rhs.begin(); left != lhs.end() && right != rhs.end();) {
+        if (*left < *right) {
+            ++left;
+        }
+        else if (*right < *left) {
+            ++right;
+        }
+        else {
+            ++intersection;
+            ++left;
+            ++right;
+        }
+    }
+    const size_t union_size = lhs.size() + rhs.size() - intersection;
+    return union_size == 0 ? 1.0 : static_cast<double>(intersection) / union_size;
+}
+
+// Система непересекающихся множеств; корень множества - его наименьший элемент
+class DisjointSets {
+public:
+    explicit DisjointSets(size_t size) :
+            parents_(size) {
+        std::iota(parents_.begin(), parents_.end(), 0);
+    }
+
+    uint32_t Find(uint32_t element) {
+        while (parents_[element] != element) {
+            parents_[element] = parents_[parents_[element]];
+            element = parents_[element];
+        }
+        return element;
+    }
+
+    void Unite(uint32_t lhs, uint32_t rhs) {
+        lhs = Find(lhs);
+        rhs = Find(rhs);
+        if (lhs != rhs) {
+            parents_[std::max(lhs, rhs)] = std::min(lhs, rhs);
+        }
+    }
+private:
+    std::vector<uint32_t> parents_;
+};
+
+using CandidatePair = std::pair<uint32_t, uint32_t>;
+
+// Наибольшая группа совпадения, в которой проверяются все пары документов
+constexpr size_t MAX_BUCKET_PAIRS_SIZE = 64;
+
+// Пары документов с одинаковым хешем полосы. Документ сравнивается с MAX_BUCKET_PAIRS_SIZE - 1 предыдущими
+// документами группы: в небольшой группе это все пары, а большая группа не порождает квадратичное число пар
+std::vector<CandidatePair> FindBandCandidates(const std::vector<uint64_t>& band_hashes) {
+    std::vector<std::pair<uint64_t, uint32_t>> keys(band_hashes.size());
+    for (size_t i = 0; i < band_hashes.size(); ++i) {
+        keys[i] = { band_hashes[i], static_cast<uint32_t>(i) };
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<CandidatePair> candidates;
+    for (size_t begin = 0; begin < keys.size();) {
+        size_t end = begin + 1;
+        for (; end < keys.size() && keys[end].first == keys[begin].first; ++end) {
+            const size_t first = std::max(begin, end - std::min(end, MAX_BUCKET_PAIRS_SIZE - 1));
+            for (size_t previous = first; previous < end; ++previous) {
+                candidates.emplace_back(keys[previous].second, keys[end].second);
+            }
+        }
+        begin = end;
+    }
+    return candidates;
+}
+}
+
+std::vector<NearDuplicateCluster> FindNearDuplicates(const SearchServer& search_server,
+    const NearDuplicateOptions& options) {
+    if (!(options.jaccard_threshold > 0.0 && options.jaccard_threshold <= 1.0)) {
+        throw std::invalid_argument("Jaccard threshold must be in (0, 1]"s);
+    }
+    if (options.bands == 0 || options.rows_per_band == 0) {
+        throw std::invalid_argument("Number of bands and rows per band must be positive"s);
+    }
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    const size_t document_count = document_ids.size();
+    const MinHasher hasher(options.bands * options.rows_per_band, options.seed);
+
+    // Хранятся только хеши полос, по массиву на полосу: полная сигнатура нужна лишь при их вычислении
+    std::vector<std::vector<uint64_t>> band_hashes(options.bands, std::vector<uint64_t>(document_count));
+    std::vector<size_t> indexes(document_count);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](const size_t i) {
+        thread_local std::vector<uint32_t> signature;
+        hasher.ComputeSignature(search_server.GetTermIds(document_ids[i]), signature);
+        for (size_t band = 0; band < options.bands; ++band) {
+            band_hashes[band][i] = hasher.GetBandHash(signature, band, options.rows_per_band);
+        }
+    });
+
+    std::vector<std::vector<CandidatePair>> band_candidates(options.bands);
+    std::transform(std::execution::par, band_hashes.begin(), band_hashes.end(), band_candidates.begin(),
+        [](const std::vector<uint64_t>& hashes) { return FindBandCandidates(hashes); });
+    band_hashes.clear();
+    std::vector<CandidatePair> candidates;
+    for (const auto& pairs : band_candidates) {
+        candidates.insert(candidates.end(), pairs.begin(), pairs.end());
+    }
+    band_candidates.clear();
+    std::sort(std::execution::par, candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // Кандидаты проверяются точной мерой Жаккара
+    std::vector<char> is_similar(candidates.size());
+    std::transform(std::execution::par, candidates.begin(), candidates.end(), is_similar.begin(),
+        [&](const CandidatePair& pair) -> char {
+            return ComputeJaccard(search_server.GetTermIds(document_ids[pair.first]),
+                search_server.GetTermIds(document_ids[pair.second])) >= options.jaccard_threshold;
+        });
+
+    DisjointSets sets(document_count);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (is_similar[i]) {
+            sets.Unite(candidates[i].first, candidates[i].second);
+        }
+    }
+    std::vector<uint32_t> roots(document_count);
+    std::vector<uint32_t> set_sizes(document_count);
+    for (uint32_t i = 0; i < document_count; ++i) {
+        roots[i] = sets.Find(i);
+        ++set_sizes[roots[i]];
+    }
+    // Корень - первый документ множества, поэтому кластер создаётся раньше, чем в него попадают остальные документы
+    std::vector<NearDuplicateCluster> clusters;
+    std::vector<uint32_t> root_clusters(document_count);
+    for (uint32_t i = 0; i < document_count; ++i) {
+        if (set_sizes[roots[i]] < 2) {
+            continue;
+        }
+        if (roots[i] == i) {
+            root_clusters[i] = static_cast<uint32_t>(clusters.size());
+            clusters.emplace_back();
+        }
+        clusters[root_clusters[roots[i]]].document_ids.push_back(document_ids[i]);
+    }
+    return clusters;
+}
+
+std::vector<NearDuplicateCluster> RemoveNearDuplicates(SearchServer& search_server,
+    const NearDuplicateOptions& options) {
+    std::vector<NearDuplicateCluster> clusters = FindNearDuplicates(search_server, options);
+    std::vector<int> removed_ids;
+    std::vector<std::vector<uint32_t>> kept_terms;
+    for (const NearDuplicateCluster& cluster : clusters) {
+        kept_terms.clear();
+        for (const int document_id : cluster.document_ids) {
+            std::vector<uint32_t> terms = search_server.GetTermIds(document_id);
+            const bool is_duplicate = std::any_of(kept_terms.begin(), kept_terms.end(),
+                [&](const std::vector<uint32_t>& kept) { return ComputeJaccard(kept, terms) >= options.jaccard_threshold; });
+            if (is_duplicate) {
+                removed_ids.push_back(document_id);
+            }
+            else {
+                kept_terms.push_back(std::move(terms));
+            }
+        }
+    }
+    search_server.RemoveDocuments(removed_ids);
+    return clusters;
+}
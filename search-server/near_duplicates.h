@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "search_server.h"
+
+// Параметры поиска почти одинаковых документов.
+// Сигнатура MinHash документа состоит из bands * rows_per_band значений; документы становятся кандидатами,
+// если у них совпадает хотя бы одна полоса (band) сигнатуры. Пара с мерой Жаккара J попадает в кандидаты
+// с вероятностью 1 - (1 - J^rows_per_band)^bands: при значениях по умолчанию 0.9996 для J = 0.8 и 0.05 для J = 0.3.
+// Оценка точна, если совпадение полосы объединяет не больше 64 документов. В большей группе документ
+// сравнивается только с 63 соседями по группе, и пара далёких документов попадает в один кластер лишь
+// через цепочку похожих документов между ними
+struct NearDuplicateOptions {
+    double jaccard_threshold = 0.8; //наименьшая мера Жаккара наборов слов, при которой документы считаются почти одинаковыми
+    size_t bands = 20;
+    size_t rows_per_band = 5;
+    uint64_t seed = 0;
+};
+
+// Документы, связанные цепочками почти одинаковых пар, по возрастанию id
+struct NearDuplicateCluster {
+    std::vector<int> document_ids;
+};
+
+// Находит кластеры почти одинаковых документов: наборы слов документов (без учёта частот) сравниваются
+// мерой Жаккара |A ∩ B| / |A ∪ B|. Сигнатуры и полосы LSH вычисляются параллельно, меры Жаккара пар-кандидатов -
+// точно по наборам слов, поэтому в кластерах нет пар, случайно совпавших по сигнатуре. Кластеры - компоненты связности
+// найденных пар, упорядочены по первому id. Время почти линейно по числу документов, если полоса сигнатуры
+// не совпадает у большинства документов.
+// Бросает std::invalid_argument, если порог вне (0, 1] или bands либо rows_per_band равны нулю
+std::vector<NearDuplicateCluster> FindNearDuplicates(const SearchServer& search_server,
+    const NearDuplicateOptions& options = {});
+
+// Удаляет почти одинаковые документы одним пакетом и возвращает найденные кластеры.
+// Кластер - цепочка похожих пар, поэтому его крайние документы могут быть непохожи: A ~ B и B ~ C при далёких A и C.
+// Документы кластера обходятся по возрастанию id; документ удаляется, только если его мера Жаккара с одним
+// из оставленных документов кластера не меньше порога, иначе он тоже остаётся. Первый документ кластера остаётся всегда
+std::vector<NearDuplicateCluster> RemoveNearDuplicates(SearchServer& search_server,
+    const NearDuplicateOptions& options = {});
@@ -0,0 +1,515 @@
+#include "posting_list.h"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SEARCH_SERVER_SSE2
+#endif
+
+namespace {
+constexpr uint32_t LANES = 4;
+
+uint32_t GetBitMask(uint32_t bits) {
+    return bits == 32 ? UINT32_MAX : (uint32_t{ 1 } << bits) - 1;
+}
+
+uint8_t GetBitWidth(uint32_t value) {
+    uint8_t bits = 0;
+    while (bits < 32 && (value >> bits) != 0) {
+        ++bits;
+    }
+    return bits;
+}
+
+size_t GetPackedWords(uint32_t count, uint32_t bits) {
+    // Полный блок занимает по bits слов в каждой из 4 полос, неполный упакован подряд
+    return count == PostingList::BLOCK_SIZE ? bits * LANES : (static_cast<size_t>(count) * bits + 31) / 32;
+}
+
+// Значение i полного блока попадает в полосу i % 4 на позицию i / 4: так 4 соседних значения распаковываются одной командой
+void PackLanes(const uint32_t* values, uint32_t bits, std::vector<uint32_t>& data) {
+    const size_t begin = data.size();
+    data.resize(begin + bits * LANES, 0);
+    if (bits == 0) {
+        return;
+    }
+    uint32_t* const out = data.data() + begin;
+    for (uint32_t position = 0; position < PostingList::BLOCK_SIZE / LANES; ++position) {
+        const uint32_t bit = position * bits;
+        const uint32_t word = bit / 32;
+        const uint32_t shift = bit % 32;
+        for (uint32_t lane = 0; lane < LANES; ++lane) {
+            const uint32_t value = values[position * LANES + lane];
+            out[word * LANES + lane] |= value << shift;
+            if (shift + bits > 32) {
+                out[(word + 1) * LANES + lane] |= value >> (32 - shift);
+            }
+        }
+    }
+}
+
+void UnpackLanes(const uint32_t* in, uint32_t bits, uint32_t* values) {
+#ifdef SEARCH_SERVER_SSE2
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(GetBitMask(bits)));
+    for (uint32_t position = 0; position < PostingList::BLOCK_SIZE / LANES; ++position) {
+        __m128i result = _mm_setzero_si128();
+        if (bits != 0) {
+            const uint32_t bit = position * bits;
+            const uint32_t word = bit / 32;
+            const uint32_t shift = bit % 32;
+            result = _mm_srl_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + word * LANES)),
+                _mm_cvtsi32_si128(static_cast<int>(shift)));
+            if (shift + bits > 32) {
+                result = _mm_or_si128(result, _mm_sll_epi32(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + (word + 1) * LANES)),
+                    _mm_cvtsi32_si128(static_cast<int>(32 - shift))));
+            }
+            result = _mm_and_si128(result, mask);
+        }
+        _mm_store_si128(reinterpret_cast<__m128i*>(values + position * LANES), result);
+    }
+#else
+    const uint32_t mask = GetBitMask(bits);
+    for (uint32_t position = 0; position < PostingList::BLOCK_SIZE / LANES; ++position) {
+        const uint32_t bit = position * bits;
+        const uint32_t word = bit / 32;
+        const uint32_t shift = bit % 32;
+        for (uint32_t lane = 0; lane < LANES; ++lane) {
+            uint32_t value = 0;
+            if (bits != 0) {
+                value = in[word * LANES + lane] >> shift;
+                if (shift + bits > 32) {
+                    value |= in[(word + 1) * LANES + lane] << (32 - shift);
+                }
+            }
+            values[position * LANES + lane] = value & mask;
+        }
+    }
+#endif
+}
+
+void PackSequential(const uint32_t* values, uint32_t count, uint32_t bits, std::vector<uint32_t>& data) {
+    const size_t begin = data.size();
+    data.resize(begin + GetPackedWords(count, bits), 0);
+    uint32_t* const out = data.data() + begin;
+    for (uint32_t i = 0; i < count && bits != 0; ++i) {
+        const uint64_t bit = static_cast<uint64_t>(i) * bits;
+        const size_t word = bit / 32;
+        const uint32_t shift = bit % 32;
+        out[word] |= values[i] << shift;
+        if (shift + bits > 32) {
+            out[word + 1] |= values[i] >> (32 - shift);
+        }
+    }
+}
+
+void UnpackSequential(const uint32_t* in, uint32_t count, uint32_t bits, uint32_t* values) {
+    const uint32_t mask = GetBitMask(bits);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t value = 0;
+        if (bits != 0) {
+            const uint64_t bit = static_cast<uint64_t>(i) * bits;
+            const size_t word = bit / 32;
+            const uint32_t shift = bit % 32;
+            value = in[word] >> shift;
+            if (shift + bits > 32) {
+                value |= in[word + 1] << (32 - shift);
+            }
+        }
+        values[i] = value & mask;
+    }
+}
+
+// Разности (d - 1) превращаются в номера документов: slots[i] = first_slot + сумма (d[k] + 1) для k = 1..i
+void RestoreSlots(uint32_t first_slot, uint32_t count, uint32_t* slots) {
+#ifdef SEARCH_SERVER_SSE2
+    if (count == PostingList::BLOCK_SIZE) {
+        const __m128i ones = _mm_set1_epi32(1);
+        __m128i carry = _mm_set1_epi32(static_cast<int>(first_slot - 1));
+        for (uint32_t i = 0; i < count; i += LANES) {
+            __m128i values = _mm_add_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(slots + i)), ones);
+            values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+            values = _mm_add_epi32(values, _mm_slli_si128(values, 8));
+            values = _mm_add_epi32(values, carry);
+            _mm_store_si128(reinterpret_cast<__m128i*>(slots + i), values);
+            carry = _mm_shuffle_epi32(values, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        return;
+    }
+#endif
+    uint32_t slot = first_slot - 1;
+    for (uint32_t i = 0; i < count; ++i) {
+        slot += slots[i] + 1;
+        slots[i] = slot;
+    }
+}
+}
+
+PostingList::Cursor::Cursor(const PostingList& list) :
+        list_(&list) {
+    LoadBlock(0);
+}
+
+bool PostingList::Cursor::IsEnd() const {
+    return block_ >= list_->blocks_.size();
+}
+
+uint32_t PostingList::Cursor::GetSlot() const {
+    return decoded_.slots[pos_];
+}
+
+uint32_t PostingList::Cursor::GetCount() const {
+    return decoded_.counts[pos_];
+}
+
+void PostingList::Cursor::Next() {
+    if (++pos_ == decoded_.size) {
+        LoadBlock(block_ + 1);
+    }
+}
+
+void PostingList::Cursor::Seek(uint32_t slot) {
+    if (IsEnd() || GetSlot() >= slot) {
+        return;
+    }
+    const FlatArray<PostingBlock>& blocks = list_->blocks_;
+    if (blocks[block_].last_slot < slot) {
+        // Галопирующий поиск по заголовкам: чаще всего нужный блок совсем рядом
+        size_t low = block_ + 1;
+        size_t step = 1;
+        while (low + step < blocks.size() && blocks[low + step].last_slot < slot) {
+            low += step;
+            step *= 2;
+        }
+        const size_t high = std::min(low + step + 1, blocks.size());
+        const auto it = std::lower_bound(blocks.begin() + low, blocks.begin() + high, slot,
+            [](const PostingBlock& block, uint32_t value) { return block.last_slot < value; });
+        LoadBlock(it - blocks.begin());
+        if (IsEnd()) {
+            return;
+        }
+    }
+    pos_ = static_cast<uint32_t>(std::lower_bound(decoded_.slots + pos_, decoded_.slots + decoded_.size, slot)
+        - decoded_.slots);
+}
+
+void PostingList::Cursor::LoadBlock(size_t block) {
+    block_ = block;
+    pos_ = 0;
+    if (!IsEnd()) {
+        list_->DecodeBlock(block_, decoded_);
+    }
+}
+
+PostingList::PostingList(FlatArray<PostingBlock> blocks, FlatArray<uint32_t> data, double max_term_freq) :
+        blocks_(std::move(blocks)),
+        data_(std::move(data)),
+        max_term_freq_(max_term_freq) {
+    size_t used_words = 0;
+    for (const PostingBlock& block : blocks_) {
+        size_ += block.size;
+        used_words += GetBlockWords(block);
+    }
+    garbage_words_ = data_.size() - std::min(used_words, data_.size());
+}
+
+void PostingList::Merge(const Posting* first, const Posting* last, double max_term_freq) {
+    if (first == last) {
+        return;
+    }
+    max_term_freq_ = std::max(max_term_freq_, max_term_freq);
+    size_ += last - first;
+    // Документы обычно добавляются по возрастанию номера: тогда перекодируется только последний неполный блок.
+    // Вхождения освобождённых номеров левее конца списка вливаются в те блоки, в диапазон которых попадают
+    const Posting* tail = first;
+    if (!blocks_.empty()) {
+        const uint32_t last_slot = blocks_[blocks_.size() - 1].last_slot;
+        tail = std::partition_point(first, last, [last_slot](const Posting& posting) { return posting.slot < last_slot; });
+    }
+    MergeIntoBlocks(first, tail);
+    if (tail != last) {
+        std::vector<PostingBlock>& blocks = blocks_.Mutable();
+        std::vector<uint32_t>& data = data_.Mutable();
+        std::vector<Posting> pending;
+        if (!blocks.empty() && blocks.back().size < BLOCK_SIZE) {
+            DecodedBlock decoded;
+            DecodeBlock(blocks.size() - 1, decoded);
+            for (uint32_t i = 0; i < decoded.size; ++i) {
+                pending.push_back({ decoded.slots[i], decoded.counts[i] });
+            }
+            ReleaseBlockData(blocks.back());
+            blocks.pop_back();
+        }
+        pending.insert(pending.end(), tail, last);
+        for (size_t begin = 0; begin < pending.size(); begin += BLOCK_SIZE) {
+            const size_t count = std::min<size_t>(BLOCK_SIZE, pending.size() - begin);
+            blocks.push_back(EncodeBlock(pending.data() + begin, count, data));
+        }
+    }
+    CompactIfSparse();
+}
+
+void PostingList::Erase(uint32_t slot) {
+    const size_t block = FindBlock(slot);
+    if (block == blocks_.size() || blocks_[block].first_slot > slot) {
+        return;
+    }
+    DecodedBlock decoded;
+    DecodeBlock(block, decoded);
+    const uint32_t* it = std::lower_bound(decoded.slots, decoded.slots + decoded.size, slot);
+    if (it == decoded.slots + decoded.size || *it != slot) {
+        return;
+    }
+    const uint32_t erased = static_cast<uint32_t>(it - decoded.slots);
+    std::vector<Posting> postings;
+    for (uint32_t i = 0; i < decoded.size; ++i) {
+        if (i != erased) {
+            postings.push_back({ decoded.slots[i], decoded.counts[i] });
+        }
+    }
+    // Перекодируется только этот блок: данные остальных блоков не сдвигаются
+    ReplaceBlocks(block, 1, postings);
+    CompactIfSparse();
+    if (--size_ == 0) {
+        max_term_freq_ = 0.0;
+    }
+}
+
+void PostingList::Erase(const uint32_t* first, const uint32_t* last) {
+    if (last - first <= 1) {
+        if (first != last) {
+            Erase(*first);
+        }
+        return;
+    }
+    // Блоки без удаляемых вхождений копируются как есть, остальные перекодируются без удалённых вхождений
+    std::vector<PostingBlock> blocks;
+    std::vector<uint32_t> data;
+    blocks.reserve(blocks_.size());
+    data.reserve(data_.size());
+    size_t erased = 0;
+    DecodedBlock decoded;
+    std::vector<Posting> postings;
+    for (size_t block = 0; block < blocks_.size(); ++block) {
+        const PostingBlock& header = blocks_[block];
+        first = std::lower_bound(first, last, header.first_slot);
+        if (first == last || *first > header.last_slot) {
+            const uint32_t* const words = data_.data() + header.data_offset;
+            blocks.push_back(header);
+            blocks.back().data_offset = static_cast<uint32_t>(data.size());
+            data.insert(data.end(), words, words + GetBlockWords(header));
+            continue;
+        }
+        DecodeBlock(block, decoded);
+        postings.clear();
+        for (uint32_t i = 0; i < decoded.size; ++i) {
+            first = std::lower_bound(first, last, decoded.slots[i]);
+            if (first != last && *first == decoded.slots[i]) {
+                ++erased;
+            }
+            else {
+                postings.push_back({ decoded.slots[i], decoded.counts[i] });
+            }
+        }
+        if (!postings.empty()) {
+            blocks.push_back(EncodeBlock(postings.data(), postings.size(), data));
+        }
+    }
+    if (erased == 0) {
+        return;
+    }
+    blocks_ = FlatArray<PostingBlock>();
+    blocks_.Mutable() = std::move(blocks);
+    data_ = FlatArray<uint32_t>();
+    data_.Mutable() = std::move(data);
+    garbage_words_ = 0;
+    size_ -= erased;
+    if (size_ == 0) {
+        max_term_freq_ = 0.0;
+    }
+}
+
+bool PostingList::Contains(uint32_t slot) const {
+    const size_t block = FindBlock(slot);
+    if (block == blocks_.size() || blocks_[block].first_slot > slot) {
+        return false;
+    }
+    if (blocks_[block].first_slot == slot || blocks_[block].last_slot == slot) {
+        return true;
+    }
+    DecodedBlock decoded;
+    DecodeBlock(block, decoded);
+    return std::binary_search(decoded.slots, decoded.slots + decoded.size, slot);
+}
+
+PostingList::Cursor PostingList::GetCursor() const {
+    return Cursor(*this);
+}
+
+double PostingList::GetMaxTermFreq() const {
+    return max_term_freq_;
+}
+
+const FlatArray<PostingBlock>& PostingList::GetBlocks() const {
+    return blocks_;
+}
+
+const FlatArray<uint32_t>& PostingList::GetData() const {
+    return data_;
+}
+
+bool PostingList::IsConsistent() const {
+    for (const PostingBlock& block : blocks_) {
+        if (block.size == 0 || block.size > BLOCK_SIZE || block.slot_bits > 32 || block.count_bits > 32
+            || block.first_slot > block.last_slot || block.data_offset > data_.size()
+            || GetBlockWords(block) > data_.size() - block.data_offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t PostingList::size() const {
+    return size_;
+}
+
+bool PostingList::empty() const {
+    return size_ == 0;
+}
+
+void PostingList::DecodeBlock(size_t block, DecodedBlock& decoded) const {
+    const PostingBlock& header = blocks_[block];
+    const uint32_t* slot_words = data_.data() + header.data_offset;
+    const uint32_t* count_words = slot_words + GetPackedWords(header.size, header.slot_bits);
+    decoded.size = header.size;
+    if (header.size == BLOCK_SIZE) {
+        UnpackLanes(slot_words, header.slot_bits, decoded.slots);
+        UnpackLanes(count_words, header.count_bits, decoded.counts);
+    }
+    else {
+        UnpackSequential(slot_words, header.size, header.slot_bits, decoded.slots);
+        UnpackSequential(count_words, header.size, header.count_bits, decoded.counts);
+    }
+    RestoreSlots(header.first_slot, header.size, decoded.slots);
+    for (uint32_t i = 0; i < header.size; ++i) {
+        ++decoded.counts[i];
+    }
+}
+
+size_t PostingList::FindBlock(uint32_t slot) const {
+    return std::lower_bound(blocks_.begin(), blocks_.end(), slot,
+        [](const PostingBlock& block, uint32_t value) { return block.last_slot < value; }) - blocks_.begin();
+}
+
+void PostingList::MergeIntoBlocks(const Posting* first, const Posting* last) {
+    DecodedBlock decoded;
+    std::vector<Posting> postings;
+    // Группы идут от последнего блока к первому, чтобы замена блоков не сдвигала номера ещё не обработанных
+    while (first != last) {
+        const size_t block = FindBlock(std::prev(last)->slot);
+        const uint32_t block_begin = block == 0 ? 0 : blocks_[block - 1].last_slot + 1;
+        const Posting* group = std::partition_point(first, last,
+            [block_begin](const Posting& posting) { return posting.slot < block_begin; });
+        DecodeBlock(block, decoded);
+        postings.clear();
+        for (uint32_t i = 0; i < decoded.size; ++i) {
+            postings.push_back({ decoded.slots[i], decoded.counts[i] });
+        }
+        const size_t old_size = postings.size();
+        postings.insert(postings.end(), group, last);
+        std::inplace_merge(postings.begin(), postings.begin() + old_size, postings.end(),
+            [](const Posting& lhs, const Posting& rhs) { return lhs.slot < rhs.slot; });
+        size_t replaced = 1;
+        // Переполненный блок делится вместе с неполным соседом, чтобы не плодить почти пустые блоки
+        if (postings.size() > BLOCK_SIZE && block + 1 < blocks_.size() && blocks_[block + 1].size < BLOCK_SIZE) {
+            DecodeBlock(block + 1, decoded);
+            for (uint32_t i = 0; i < decoded.size; ++i) {
+                postings.push_back({ decoded.slots[i], decoded.counts[i] });
+            }
+            replaced = 2;
+        }
+        ReplaceBlocks(block, replaced, postings);
+        last = group;
+    }
+}
+
+void PostingList::ReplaceBlocks(size_t block, size_t count, const std::vector<Posting>& postings) {
+    std::vector<PostingBlock>& blocks = blocks_.Mutable();
+    std::vector<uint32_t>& data = data_.Mutable();
+    for (size_t i = block + count; i-- > block;) {
+        ReleaseBlockData(blocks[i]);
+    }
+    std::vector<PostingBlock> encoded;
+    for (size_t begin = 0; begin < postings.size(); begin += BLOCK_SIZE) {
+        const size_t chunk = std::min<size_t>(BLOCK_SIZE, postings.size() - begin);
+        encoded.push_back(EncodeBlock(postings.data() + begin, chunk, data));
+    }
+    const size_t common = std::min(count, encoded.size());
+    std::copy(encoded.begin(), encoded.begin() + common, blocks.begin() + block);
+    if (count > common) {
+        blocks.erase(blocks.begin() + block + common, blocks.begin() + block + count);
+    }
+    else {
+        blocks.insert(blocks.begin() + block + common, encoded.begin() + common, encoded.end());
+    }
+}
+
+void PostingList::ReleaseBlockData(const PostingBlock& block) {
+    std::vector<uint32_t>& data = data_.Mutable();
+    const size_t words = GetBlockWords(block);
+    if (block.data_offset + words == data.size()) {
+        data.resize(block.data_offset);
+    }
+    else {
+        garbage_words_ += words;
+    }
+}
+
+void PostingList::CompactIfSparse() {
+    // Сжатие переписывает весь список, но случается не чаще, чем мусор успевает вырасти до половины данных,
+    // поэтому в среднем на одно изменение приходится O(размер блока)
+    if (garbage_words_ * 2 <= data_.size()) {
+        return;
+    }
+    std::vector<PostingBlock>& blocks = blocks_.Mutable();
+    std::vector<uint32_t> data;
+    data.reserve(data_.size() - garbage_words_);
+    for (PostingBlock& block : blocks) {
+        const uint32_t* const words = data_.data() + block.data_offset;
+        block.data_offset = static_cast<uint32_t>(data.size());
+        data.insert(data.end(), words, words + GetBlockWords(block));
+    }
+    data_ = FlatArray<uint32_t>();
+    data_.Mutable() = std::move(data);
+    garbage_words_ = 0;
+}
+
+PostingBlock PostingList::EncodeBlock(const Posting* postings, size_t count, std::vector<uint32_t>& data) {
+    uint32_t slot_gaps[BLOCK_SIZE];
+    uint32_t counts[BLOCK_SIZE];
+    uint32_t max_gap = 0;
+    uint32_t max_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        slot_gaps[i] = i == 0 ? 0 : postings[i].slot - postings[i - 1].slot - 1;
+        counts[i] = postings[i].count - 1;
+        max_gap = std::max(max_gap, slot_gaps[i]);
+        max_count = std::max(max_count, counts[i]);
+    }
+    PostingBlock block{ postings[0].slot, postings[count - 1].slot, static_cast<uint32_t>(data.size()),
+        static_cast<uint16_t>(count), GetBitWidth(max_gap), GetBitWidth(max_count) };
+    if (count == BLOCK_SIZE) {
+        PackLanes(slot_gaps, block.slot_bits, data);
+        PackLanes(counts, block.count_bits, data);
+    }
+    else {
+        PackSequential(slot_gaps, static_cast<uint32_t>(count), block.slot_bits, data);
+        PackSequential(counts, static_cast<uint32_t>(count), block.count_bits, data);
+    }
+    return block;
+}
+
+size_t PostingList::GetBlockWords(const PostingBlock& block) {
+    return GetPackedWords(block.size, block.slot_bits) + GetPackedWords(block.size, block.count_bits);
+}
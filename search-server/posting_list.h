@@ -0,0 +1,157 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "flat_array.h"
+
+struct Posting {
+    uint32_t slot; //внутренний номер документа в SearchServer
+    uint32_t count; //сколько раз слово встречается в документе
+};
+
+// Заголовок блока сжатого списка вхождений. По first_slot и last_slot блок пропускается без распаковки
+struct PostingBlock {
+    uint32_t first_slot;
+    uint32_t last_slot;
+    uint32_t data_offset; //начало упакованных данных блока в массиве слов списка
+    uint16_t size;
+    uint8_t slot_bits; //ширина разностей соседних номеров документов (минус 1)
+    uint8_t count_bits; //ширина (count - 1)
+};
+
+// Список вхождений слова, отсортированный по внутреннему номеру документа и сжатый блоками по BLOCK_SIZE вхождений:
+// разности соседних номеров и количества вхождений упакованы минимальным для блока числом бит.
+// Полные блоки хранятся в раскладке с чередованием по 4 значения и распаковываются SSE2 вместе с префиксной суммой,
+// неполные (последний блок и блоки, из которых удаляли документы) упакованы подряд и распаковываются поэлементно.
+// Изменённый блок перекодируется в конец массива данных, а его прежние слова остаются мусором до сжатия списка
+class PostingList {
+public:
+    static constexpr uint32_t BLOCK_SIZE = 128;
+
+    struct DecodedBlock {
+        alignas(16) uint32_t slots[BLOCK_SIZE];
+        alignas(16) uint32_t counts[BLOCK_SIZE];
+        uint32_t size = 0;
+    };
+
+    // Последовательный проход по списку с распаковкой по одному блоку
+    class Cursor {
+    public:
+        explicit Cursor(const PostingList& list);
+
+        bool IsEnd() const;
+
+        uint32_t GetSlot() const;
+
+        uint32_t GetCount() const;
+
+        void Next();
+
+        // Переходит к первому вхождению с номером документа >= slot; блоки, целиком лежащие левее, не распаковываются
+        void Seek(uint32_t slot);
+    private:
+        const PostingList* list_;
+        size_t block_ = 0;
+        uint32_t pos_ = 0;
+        DecodedBlock decoded_;
+
+        void LoadBlock(size_t block);
+    };
+
+    PostingList() = default;
+
+    // Список, читающий готовые блоки из чужой памяти (см. FlatArray::Borrow)
+    PostingList(FlatArray<PostingBlock> blocks, FlatArray<uint32_t> data, double max_term_freq);
+
+    // Добавляет вхождения новых документов [first, last), отсортированные по номеру документа.
+    // Номера документов не должны встречаться в списке; max_term_freq - наибольшая Term frequency среди новых вхождений
+    void Merge(const Posting* first, const Posting* last, double max_term_freq);
+
+    void Erase(uint32_t slot);
+
+    // Удаляет вхождения документов [first, last), отсортированных по номеру документа, перекодируя список один раз
+    void Erase(const uint32_t* first, const uint32_t* last);
+
+    bool Contains(uint32_t slot) const;
+
+    Cursor GetCursor() const;
+
+    // Вызывает action(slot, count) для всех вхождений по возрастанию номера документа
+    template <typename Action>
+    void ForEach(Action action) const;
+
+    // То же для вхождений с номерами документов из [begin_slot, end_slot)
+    template <typename Action>
+    void ForEach(uint32_t begin_slot, uint32_t end_slot, Action action) const;
+
+    // Верхняя граница Term frequency в списке - граница вклада слова в релевантность.
+    // После удаления документов может быть завышена
+    double GetMaxTermFreq() const;
+
+    const FlatArray<PostingBlock>& GetBlocks() const;
+
+    const FlatArray<uint32_t>& GetData() const;
+
+    // Проверяет, что упакованные данные каждого блока лежат в пределах массива (для списков из снимка)
+    bool IsConsistent() const;
+
+    size_t size() const;
+
+    bool empty() const;
+private:
+    FlatArray<PostingBlock> blocks_;
+    FlatArray<uint32_t> data_;
+    size_t size_ = 0;
+    double max_term_freq_ = 0.0;
+    size_t garbage_words_ = 0; //слова data_, не принадлежащие ни одному блоку
+
+    void DecodeBlock(size_t block, DecodedBlock& decoded) const;
+
+    // Номер первого блока, который может содержать slot (last_slot >= slot)
+    size_t FindBlock(uint32_t slot) const;
+
+    // Вливает вхождения [first, last), лежащие не правее последнего блока, в блоки их диапазонов
+    void MergeIntoBlocks(const Posting* first, const Posting* last);
+
+    // Заменяет count блоков, начиная с block, блоками из postings (по BLOCK_SIZE вхождений)
+    void ReplaceBlocks(size_t block, size_t count, const std::vector<Posting>& postings);
+
+    // Отдаёт слова блока: в конце массива они отрезаются, иначе учитываются как мусор
+    void ReleaseBlockData(const PostingBlock& block);
+
+    // Переписывает данные блоков подряд, когда мусор занимает больше половины массива
+    void CompactIfSparse();
+
+    // Упаковывает count вхождений в конец data и возвращает заголовок блока
+    static PostingBlock EncodeBlock(const Posting* postings, size_t count, std::vector<uint32_t>& data);
+
+    static size_t GetBlockWords(const PostingBlock& block);
+};
+
+template <typename Action>
+void PostingList::ForEach(Action action) const {
+    DecodedBlock decoded;
+    for (size_t block = 0; block < blocks_.size(); ++block) {
+        DecodeBlock(block, decoded);
+        for (uint32_t i = 0; i < decoded.size; ++i) {
+            action(decoded.slots[i], decoded.counts[i]);
+        }
+    }
+}
+
+template <typename Action>
+void PostingList::ForEach(uint32_t begin_slot, uint32_t end_slot, Action action) const {
+    DecodedBlock decoded;
+    for (size_t block = FindBlock(begin_slot); block < blocks_.size() && blocks_[block].first_slot < end_slot; ++block) {
+        DecodeBlock(block, decoded);
+        for (uint32_t i = 0; i < decoded.size; ++i) {
+            const uint32_t slot = decoded.slots[i];
+            if (slot >= end_slot) {
+                return;
+            }
+            if (slot >= begin_slot) {
+                action(slot, decoded.counts[i]);
+            }
+        }
+    }
+}
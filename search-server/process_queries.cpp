@@ -3,26 +3,43 @@
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
-    std::vector<std::vector<Document>> result(queries.size());
-    std::transform(std::execution::par,
-        queries.begin(), queries.end(),
-        result.begin(),
-        [&search_server](const std::string& query)
-        { return search_server.FindTopDocuments(query); });
-    return result;
+    return search_server.FindTopDocumentsBatch(queries);
 }
 
-std::list<Document> ProcessQueriesJoined(
+JoinedResults ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries) {
-    std::list<Document> result;
-    auto test = ProcessQueries(search_server, queries);
-    std::for_each(
-        test.begin(), test.end(),
-        [&result](const std::vector<Document> documents) {
-            for (const Document& document : documents) {
-                result.push_back(document);
-            }
-        });
-    return result;
-}
\ No newline at end of file
+    std::vector<Document> documents;
+    std::vector<size_t> offsets;
+    search_server.FindTopDocumentsBatchJoined(queries, documents, offsets);
+    return JoinedResults(std::move(documents), std::move(offsets));
+}
+
+JoinedResults::JoinedResults(std::vector<Document> documents, std::vector<size_t> offsets) :
+        documents_(std::move(documents)),
+        offsets_(std::move(offsets)) {
+    }
+
+JoinedResults::ConstIterator JoinedResults::begin() const {
+    return documents_.begin();
+}
+
+JoinedResults::ConstIterator JoinedResults::end() const {
+    return documents_.end();
+}
+
+size_t JoinedResults::size() const {
+    return documents_.size();
+}
+
+bool JoinedResults::empty() const {
+    return documents_.empty();
+}
+
+size_t JoinedResults::GetQueryCount() const {
+    return offsets_.size() - 1;
+}
+
+IteratorRange<JoinedResults::ConstIterator> JoinedResults::GetQueryResults(size_t query_index) const {
+    return { documents_.begin() + offsets_.at(query_index), documents_.begin() + offsets_.at(query_index + 1) };
+}
@@ -1,14 +1,39 @@
 #pragma once
 #include <vector>
 #include <execution>
-#include <list>
 #include <string>
+#include "paginator.h"
 #include "search_server.h"
 
+// Результаты пакета запросов в одном непрерывном массиве: документы запроса i лежат в [offsets[i], offsets[i + 1])
+class JoinedResults {
+public:
+    using ConstIterator = std::vector<Document>::const_iterator;
+
+    JoinedResults() = default;
+
+    JoinedResults(std::vector<Document> documents, std::vector<size_t> offsets);
+
+    ConstIterator begin() const;
+
+    ConstIterator end() const;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    size_t GetQueryCount() const;
+
+    IteratorRange<ConstIterator> GetQueryResults(size_t query_index) const;
+private:
+    std::vector<Document> documents_;
+    std::vector<size_t> offsets_ = { 0 };
+};
+
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
 
-std::list<Document> ProcessQueriesJoined(
+JoinedResults ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
\ No newline at end of file
+    const std::vector<std::string>& queries);
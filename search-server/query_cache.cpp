@@ -0,0 +1,95 @@
+#include "query_cache.h"
+#include <algorithm>
+
+bool QueryCache::Key::operator==(const Key& other) const {
+    return filter == other.filter && top_k == other.top_k
+        && plus_words == other.plus_words && minus_words == other.minus_words;
+}
+
+size_t QueryCache::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = key.filter * 0x9E3779B97F4A7C15ull ^ key.top_k;
+    const auto mix = [&hash](uint64_t value) {
+        hash = (hash ^ value) * 0x100000001B3ull;
+        hash ^= hash >> 29;
+    };
+    for (const uint32_t term_id : key.plus_words) {
+        mix(term_id);
+    }
+    mix(UINT64_MAX); //разделитель, чтобы {a}, {b} и {a, b}, {} давали разные значения
+    for (const uint32_t term_id : key.minus_words) {
+        mix(term_id);
+    }
+    return static_cast<size_t>(hash);
+}
+
+QueryCache::QueryCache(size_t capacity, size_t shard_count) :
+        capacity_(capacity),
+        shard_capacity_(0),
+        shards_(std::max<size_t>(1, std::min(shard_count, capacity))) {
+    shard_capacity_ = (capacity + shards_.size() - 1) / shards_.size();
+}
+
+std::optional<std::vector<Document>> QueryCache::Find(const Key& key, uint64_t generation) {
+    if (shard_capacity_ == 0) {
+        ++miss_count_;
+        return std::nullopt;
+    }
+    Shard& shard = shards_[KeyHash{}(key) % shards_.size()];
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    const auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        ++miss_count_;
+        return std::nullopt;
+    }
+    // Результаты, полученные до изменения индекса, устарели
+    if (it->second->generation != generation) {
+        shard.entries.erase(it->second);
+        shard.index.erase(it);
+        ++miss_count_;
+        return std::nullopt;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    ++hit_count_;
+    return it->second->documents;
+}
+
+void QueryCache::Insert(Key key, uint64_t generation, std::vector<Document> documents) {
+    if (shard_capacity_ == 0) {
+        return;
+    }
+    Shard& shard = shards_[KeyHash{}(key) % shards_.size()];
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    const auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        it->second->generation = generation;
+        it->second->documents = std::move(documents);
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+    if (shard.entries.size() >= shard_capacity_) {
+        shard.index.erase(shard.entries.back().key);
+        shard.entries.pop_back();
+    }
+    shard.entries.push_front({ key, generation, std::move(documents) });
+    shard.index.emplace(std::move(key), shard.entries.begin());
+}
+
+void QueryCache::Clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        shard.index.clear();
+        shard.entries.clear();
+    }
+}
+
+size_t QueryCache::GetCapacity() const {
+    return capacity_;
+}
+
+size_t QueryCache::GetHitCount() const {
+    return hit_count_;
+}
+
+size_t QueryCache::GetMissCount() const {
+    return miss_count_;
+}
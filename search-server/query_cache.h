@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "document.h"
+
+// Кэш результатов поиска с вытеснением давно не использованных запросов (LRU).
+// Разделён на сегменты с отдельными блокировками, чтобы параллельные запросы не ждали друг друга
+class QueryCache {
+public:
+    // Нормализованный запрос: отсортированные id плюс- и минус-слов без повторов,
+    // ключ фильтра документов (например, статус) и количество запрошенных документов
+    struct Key {
+        std::vector<uint32_t> plus_words;
+        std::vector<uint32_t> minus_words;
+        uint64_t filter = 0;
+        size_t top_k = 0;
+
+        bool operator==(const Key& other) const;
+    };
+
+    // capacity - наибольшее число запросов в кэше
+    explicit QueryCache(size_t capacity, size_t shard_count = 16);
+
+    // Результат, сохранённый для того же поколения индекса
+    std::optional<std::vector<Document>> Find(const Key& key, uint64_t generation);
+
+    void Insert(Key key, uint64_t generation, std::vector<Document> documents);
+
+    void Clear();
+
+    size_t GetCapacity() const;
+
+    size_t GetHitCount() const;
+
+    size_t GetMissCount() const;
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        Key key;
+        uint64_t generation;
+        std::vector<Document> documents;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> entries; //в начале - недавно использованные
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    };
+
+    size_t capacity_;
+    size_t shard_capacity_;
+    std::vector<Shard> shards_;
+    std::atomic<size_t> hit_count_ = 0;
+    std::atomic<size_t> miss_count_ = 0;
+};
@@ -1,23 +1,103 @@
 #include "remove_duplicates.h"
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <tuple>
+#include <utility>
 
-void RemoveDuplicates(SearchServer& search_server) {
-	std::set<int> ids_to_remove;
-	std::map<std::set<std::string>, int> words_to_id;
-	for (const int it : search_server) {
-		std::set<std::string> words;
-		for (const auto& [key, value] : search_server.GetWordFrequencies(it)) {
-			words.emplace(key);
-		}
-		auto it_ = words_to_id.find(words);
-		if (it_ == words_to_id.end()) {
-			words_to_id[words] = it;
+namespace {
+struct Fingerprint {
+	uint64_t low;
+	uint64_t high;
+
+	bool operator==(const Fingerprint& other) const {
+		return low == other.low && high == other.high;
+	}
+
+	bool operator<(const Fingerprint& other) const {
+		return std::tie(low, high) < std::tie(other.low, other.high);
+	}
+};
+
+// Финальное перемешивание SplitMix64: каждый бит результата зависит от всех бит аргумента
+uint64_t Mix(uint64_t value) {
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
+
+// Две независимые цепочки хешей по отсортированным id слов
+Fingerprint ComputeFingerprint(const std::vector<uint32_t>& term_ids) {
+	Fingerprint fingerprint{ Mix(term_ids.size()), Mix(term_ids.size() ^ 0x9E3779B97F4A7C15ull) };
+	for (const uint32_t term_id : term_ids) {
+		fingerprint.low = Mix(fingerprint.low ^ term_id);
+		fingerprint.high = Mix((fingerprint.high + term_id) * 0xC2B2AE3D27D4EB4Full);
+	}
+	return fingerprint;
+}
+
+// Документы group упорядочены по id: каждый сравнивается с различными наборами слов, встреченными раньше
+std::vector<DuplicateDocument> VerifyGroup(const SearchServer& search_server,
+	const std::pair<Fingerprint, int>* first, const std::pair<Fingerprint, int>* last) {
+	std::vector<DuplicateDocument> duplicates;
+	std::vector<std::pair<std::vector<uint32_t>, int>> originals;
+	for (; first != last; ++first) {
+		std::vector<uint32_t> term_ids = search_server.GetTermIds(first->second);
+		const auto original = std::find_if(originals.begin(), originals.end(),
+			[&term_ids](const auto& entry) { return entry.first == term_ids; });
+		if (original == originals.end()) {
+			originals.emplace_back(std::move(term_ids), first->second);
 		}
 		else {
-			(it < it_->second) ? ids_to_remove.emplace(it_->second) : ids_to_remove.emplace(it);
+			duplicates.push_back({ first->second, original->second });
+		}
+	}
+	return duplicates;
+}
+}
+
+std::vector<DuplicateDocument> FindDuplicates(const SearchServer& search_server) {
+	const std::vector<int> document_ids(search_server.begin(), search_server.end());
+	std::vector<std::pair<Fingerprint, int>> fingerprints(document_ids.size());
+	std::transform(std::execution::par, document_ids.begin(), document_ids.end(), fingerprints.begin(),
+		[&search_server](const int document_id) {
+			return std::pair{ ComputeFingerprint(search_server.GetTermIds(document_id)), document_id };
+		});
+	std::sort(std::execution::par, fingerprints.begin(), fingerprints.end());
+
+	// Проверяются только группы из нескольких документов с одинаковым отпечатком
+	std::vector<std::pair<size_t, size_t>> groups;
+	for (size_t begin = 0; begin < fingerprints.size();) {
+		size_t end = begin + 1;
+		while (end < fingerprints.size() && fingerprints[end].first == fingerprints[begin].first) {
+			++end;
+		}
+		if (end - begin > 1) {
+			groups.emplace_back(begin, end);
 		}
+		begin = end;
 	}
-	for (int id : ids_to_remove) {
-		std::cout << "Found duplicate document id " << id << std::endl;
-		search_server.RemoveDocument(id);
+	std::vector<std::vector<DuplicateDocument>> group_duplicates(groups.size());
+	std::transform(std::execution::par, groups.begin(), groups.end(), group_duplicates.begin(),
+		[&](const std::pair<size_t, size_t>& group) {
+			return VerifyGroup(search_server, fingerprints.data() + group.first, fingerprints.data() + group.second);
+		});
+
+	std::vector<DuplicateDocument> duplicates;
+	for (const auto& group : group_duplicates) {
+		duplicates.insert(duplicates.end(), group.begin(), group.end());
 	}
-}
\ No newline at end of file
+	std::sort(duplicates.begin(), duplicates.end(), [](const DuplicateDocument& lhs, const DuplicateDocument& rhs) {
+		return lhs.document_id < rhs.document_id;
+	});
+	return duplicates;
+}
+
+std::vector<DuplicateDocument> RemoveDuplicates(SearchServer& search_server) {
+	std::vector<DuplicateDocument> duplicates = FindDuplicates(search_server);
+	std::vector<int> document_ids(duplicates.size());
+	std::transform(duplicates.begin(), duplicates.end(), document_ids.begin(),
+		[](const DuplicateDocument& duplicate) { return duplicate.document_id; });
+	search_server.RemoveDocuments(document_ids);
+	return duplicates;
+}
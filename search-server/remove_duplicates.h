@@ -1,5 +1,18 @@
 #pragma once
-#include <set>
+#include <vector>
 #include "search_server.h"
 
-void RemoveDuplicates(SearchServer& search_server);
\ No newline at end of file
+// Документ, набор слов которого совпадает с набором слов документа original_id с меньшим id
+struct DuplicateDocument {
+	int document_id;
+	int original_id;
+};
+
+// Находит документы с тем же набором слов (без учёта частот), что и у документа с меньшим id.
+// 128-битные отпечатки наборов слов вычисляются параллельно; документы с одинаковым отпечатком
+// сравниваются точно, поэтому совпадение отпечатков разных наборов не приводит к ошибке.
+// Результат упорядочен по document_id
+std::vector<DuplicateDocument> FindDuplicates(const SearchServer& search_server);
+
+// Удаляет найденные FindDuplicates документы одним пакетом и возвращает их
+std::vector<DuplicateDocument> RemoveDuplicates(SearchServer& search_server);
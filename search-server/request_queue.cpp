@@ -1,37 +1,48 @@
 #include "request_queue.h"
 
-RequestQueue::RequestQueue(const SearchServer& search_server) : 
+RequestQueue::RequestQueue(const SearchServer& search_server, const std::vector<std::chrono::seconds>& windows) :
         search_server_(search_server),
-        no_results_requests_(0),
-        current_time_(0) {
+        last_requests_(REQUEST_WINDOW),
+        statistics_(windows) {
     }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
+    const Clock::time_point start_time = Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query, status);
-    AddRequest(result.size());
+    AddRequest(result.size(), start_time);
     return result;
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
+    const Clock::time_point start_time = Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query);
-    AddRequest(result.size());
+    AddRequest(result.size(), start_time);
     return result;
 }
 
 int RequestQueue::GetNoResultRequests() const {
-     return no_results_requests_;
+     return no_results_requests_.load(std::memory_order_relaxed);
+}
+
+std::vector<RequestWindowStatistics> RequestQueue::GetStatistics() const {
+    return statistics_.GetStatistics(Clock::now());
 }
     
-void RequestQueue::AddRequest(int results_num) {
-    ++current_time_;
-    while (!requests_.empty() && current_time_ - requests_.front().time_stamp >= min_in_day_) {
-        if (requests_.front().results == 0) {
-            --no_results_requests_;
+void RequestQueue::AddRequest(size_t results_num, Clock::time_point start_time) {
+    const Clock::time_point end_time = Clock::now();
+    statistics_.Record(end_time, end_time - start_time, results_num == 0);
+
+    const uint64_t index = request_count_.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t record = ((index + 1) << 1) | (results_num == 0 ? 1 : 0);
+    std::atomic<uint64_t>& cell = last_requests_[index % REQUEST_WINDOW];
+    // Запрос вытесняет из ячейки запрос, отстоящий от него на REQUEST_WINDOW. Если ячейку уже занял
+    // более поздний запрос (поток задержался между получением номера и записью), этот запрос уже вне окна
+    uint64_t old_record = cell.load(std::memory_order_relaxed);
+    while (old_record < record) {
+        if (cell.compare_exchange_weak(old_record, record, std::memory_order_relaxed)) {
+            no_results_requests_.fetch_add(static_cast<int>(record & 1) - static_cast<int>(old_record & 1),
+                std::memory_order_relaxed);
+            break;
         }
-        requests_.pop_front();
     }
-    requests_.push_back({ current_time_, results_num });
-    if (results_num == 0) {
-        ++no_results_requests_;
-    }
-}
\ No newline at end of file
+}
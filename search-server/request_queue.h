@@ -1,10 +1,22 @@
 #pragma once
-#include <deque>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "request_statistics.h"
 #include "search_server.h"
 
+// Очередь запросов к серверу: считает запросы без результатов среди последних REQUEST_WINDOW запросов
+// и собирает статистику запросов за скользящие окна времени (см. RequestStatistics).
+// AddFindRequest можно вызывать из нескольких потоков одновременно, например из обработчиков ProcessQueries
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server);
+    using Clock = RequestStatistics::Clock;
+
+    static constexpr int REQUEST_WINDOW = 1440;
+
+    explicit RequestQueue(const SearchServer& search_server,
+        const std::vector<std::chrono::seconds>& windows = { std::chrono::minutes(1), std::chrono::minutes(5),
+            std::chrono::minutes(15) });
 
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
@@ -13,24 +25,27 @@ public:
     
     std::vector<Document> AddFindRequest(const std::string& raw_query);
     
+    // Пока другие потоки добавляют запросы, значение может не учитывать часть из них
     int GetNoResultRequests() const;
+
+    // Показатели окон, заканчивающихся сейчас, в порядке, в котором окна переданы в конструктор
+    std::vector<RequestWindowStatistics> GetStatistics() const;
 private:
-    struct QueryResult {
-        uint64_t time_stamp;
-        int results;
-    };
-    std::deque<QueryResult> requests_;
     const SearchServer& search_server_;
-    const static int min_in_day_ = 1440;
-    int no_results_requests_ = 0;
-    uint64_t current_time_;
+    // Ячейка i хранит последний запрос с номером, равным i по модулю REQUEST_WINDOW:
+    // (номер + 1) * 2 плюс 1, если у запроса нет результатов; 0 - запросов ещё не было
+    std::vector<std::atomic<uint64_t>> last_requests_;
+    std::atomic<uint64_t> request_count_{ 0 };
+    std::atomic<int> no_results_requests_{ 0 };
+    RequestStatistics statistics_;
     
-    void AddRequest(int results_num);
+    void AddRequest(size_t results_num, Clock::time_point start_time);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+    const Clock::time_point start_time = Clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    AddRequest(result.size());
+    AddRequest(result.size(), start_time);
     return result;
-}
\ No newline at end of file
+}
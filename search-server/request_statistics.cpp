@@ -0,0 +1,153 @@
+#include "request_statistics.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+using namespace std::literals;
+
+namespace {
+template <typename Buckets, typename Histogram>
+uint64_t GetValueAtPercentile(const Histogram& histogram, uint64_t count, double percentile) {
+    if (count == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * count)));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < histogram.size(); ++bucket) {
+        seen += histogram[bucket];
+        if (seen >= rank) {
+            return Buckets::GetUpperBound(bucket);
+        }
+    }
+    return Buckets::GetUpperBound(histogram.size() - 1);
+}
+}
+
+RequestStatistics::RequestStatistics(const std::vector<std::chrono::seconds>& windows,
+    std::chrono::milliseconds bucket_width) :
+        windows_(windows),
+        bucket_width_(bucket_width) {
+    if (windows_.empty()) {
+        throw std::invalid_argument("No statistics windows"s);
+    }
+    if (bucket_width_.count() <= 0) {
+        throw std::invalid_argument("Statistics bucket width must be positive"s);
+    }
+    for (const std::chrono::seconds window : windows_) {
+        if (window.count() <= 0) {
+            throw std::invalid_argument("Statistics window must be positive"s);
+        }
+        const std::chrono::nanoseconds length = window;
+        window_buckets_.push_back(static_cast<uint64_t>((length.count() + bucket_width_.count() - 1) / bucket_width_.count()));
+    }
+    // Лишний интервал не даёт текущему интервалу затереть самый старый интервал самого длинного окна
+    bucket_count_ = static_cast<size_t>(*std::max_element(window_buckets_.begin(), window_buckets_.end())) + 1;
+    buckets_ = std::make_unique<Bucket[]>(bucket_count_);
+}
+
+void RequestStatistics::Record(Clock::time_point time, std::chrono::nanoseconds latency, bool no_results) {
+    Bucket* const bucket = AcquireBucket(GetEpoch(time));
+    if (bucket == nullptr) {
+        return;
+    }
+    bucket->requests.fetch_add(1, std::memory_order_relaxed);
+    if (no_results) {
+        bucket->no_result_requests.fetch_add(1, std::memory_order_relaxed);
+    }
+    const uint64_t latency_ns = static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(0, latency.count()));
+    bucket->latencies[LatencyBuckets::GetBucket(latency_ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<RequestWindowStatistics> RequestStatistics::GetStatistics(Clock::time_point now) const {
+    std::vector<size_t> order(windows_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+        return window_buckets_[lhs] < window_buckets_[rhs];
+    });
+
+    std::vector<RequestWindowStatistics> result(windows_.size());
+    uint64_t requests = 0;
+    uint64_t no_result_requests = 0;
+    std::array<uint64_t, LatencyBuckets::COUNT> latencies{};
+    std::array<uint32_t, LatencyBuckets::COUNT> bucket_latencies{};
+
+    const auto fill_window = [&](size_t window) {
+        RequestWindowStatistics& statistics = result[window];
+        statistics.window = windows_[window];
+        statistics.requests = requests;
+        statistics.no_result_requests = no_result_requests;
+        statistics.no_result_rate = requests == 0 ? 0.0 : static_cast<double>(no_result_requests) / requests;
+        statistics.queries_per_second = static_cast<double>(requests) / windows_[window].count();
+        statistics.latency_p50_ns = GetValueAtPercentile<LatencyBuckets>(latencies, requests, 50.0);
+        statistics.latency_p90_ns = GetValueAtPercentile<LatencyBuckets>(latencies, requests, 90.0);
+        statistics.latency_p99_ns = GetValueAtPercentile<LatencyBuckets>(latencies, requests, 99.0);
+    };
+
+    // Интервалы обходятся от текущего к старым; окно заполняется, как только пройдены все его интервалы
+    const uint64_t now_epoch = GetEpoch(now);
+    size_t next_window = 0;
+    for (uint64_t distance = 0; distance <= now_epoch && next_window < order.size(); ++distance) {
+        const uint64_t epoch = now_epoch - distance;
+        const Bucket& bucket = buckets_[epoch % bucket_count_];
+        // Чтение по схеме seqlock: если за время чтения интервал обнулили для другого времени, он пропускается
+        if (bucket.epoch.load(std::memory_order_acquire) == epoch) {
+            const uint32_t bucket_requests = bucket.requests.load(std::memory_order_relaxed);
+            const uint32_t bucket_no_result_requests = bucket.no_result_requests.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < LatencyBuckets::COUNT; ++i) {
+                bucket_latencies[i] = bucket.latencies[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (bucket.epoch.load(std::memory_order_relaxed) == epoch) {
+                requests += bucket_requests;
+                no_result_requests += bucket_no_result_requests;
+                for (size_t i = 0; i < LatencyBuckets::COUNT; ++i) {
+                    latencies[i] += bucket_latencies[i];
+                }
+            }
+        }
+        while (next_window < order.size() && window_buckets_[order[next_window]] == distance + 1) {
+            fill_window(order[next_window++]);
+        }
+    }
+    // Окна, которые длиннее всего прошедшего времени
+    for (; next_window < order.size(); ++next_window) {
+        fill_window(order[next_window]);
+    }
+    return result;
+}
+
+uint64_t RequestStatistics::GetEpoch(Clock::time_point time) const {
+    const std::chrono::nanoseconds since_epoch = time.time_since_epoch();
+    return since_epoch.count() <= 0 ? 0 : static_cast<uint64_t>(since_epoch.count() / bucket_width_.count());
+}
+
+RequestStatistics::Bucket* RequestStatistics::AcquireBucket(uint64_t epoch) {
+    Bucket& bucket = buckets_[epoch % bucket_count_];
+    const uint64_t bucket_epoch = bucket.epoch.load(std::memory_order_acquire);
+    if (bucket_epoch == epoch) {
+        return &bucket;
+    }
+    if (bucket_epoch != UNUSED_EPOCH && bucket_epoch > epoch) {
+        return nullptr;
+    }
+    std::lock_guard guard(bucket.reset_mutex);
+    const uint64_t locked_epoch = bucket.epoch.load(std::memory_order_relaxed);
+    if (locked_epoch == epoch) {
+        return &bucket;
+    }
+    if (locked_epoch != UNUSED_EPOCH && locked_epoch > epoch) {
+        return nullptr;
+    }
+    // Сначала интервал помечается неиспользуемым, чтобы читатели не смешали старые и новые значения
+    bucket.epoch.store(UNUSED_EPOCH, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bucket.requests.store(0, std::memory_order_relaxed);
+    bucket.no_result_requests.store(0, std::memory_order_relaxed);
+    for (auto& latency : bucket.latencies) {
+        latency.store(0, std::memory_order_relaxed);
+    }
+    bucket.epoch.store(epoch, std::memory_order_release);
+    return &bucket;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "latency_buckets.h"
+
+// Показатели запросов за одно скользящее окно
+struct RequestWindowStatistics {
+    std::chrono::seconds window;
+    uint64_t requests = 0;
+    uint64_t no_result_requests = 0;
+    double no_result_rate = 0.0;     //доля запросов без результатов
+    double queries_per_second = 0.0; //число запросов, делённое на длину окна
+    uint64_t latency_p50_ns = 0;
+    uint64_t latency_p90_ns = 0;
+    uint64_t latency_p99_ns = 0;
+};
+
+// Статистика запросов за несколько скользящих окон времени.
+//
+// Время делится на интервалы длины bucket_width; у каждого интервала свои атомарные счётчики и гистограмма
+// задержек с погрешностью 1/8. Интервалы хранятся в кольцевом буфере на самое длинное окно, и интервал,
+// отставший на круг, обнуляется первым же запросом, который в него попадает. Record можно вызывать
+// из любого числа потоков: общая блокировка не нужна, обнуление интервала блокирует только этот интервал.
+// Окно покрывает целое число последних интервалов, включая текущий.
+//
+// Память - около 2 КБ на интервал: окно в 15 минут при интервалах в секунду занимает около 1.8 МБ
+class RequestStatistics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Бросает std::invalid_argument, если окон нет или длина окна либо интервала не положительна
+    explicit RequestStatistics(const std::vector<std::chrono::seconds>& windows,
+        std::chrono::milliseconds bucket_width = std::chrono::seconds(1));
+
+    // Запросы с временем старше самого длинного окна не учитываются
+    void Record(Clock::time_point time, std::chrono::nanoseconds latency, bool no_results);
+
+    // Показатели окон, заканчивающихся в момент now, в порядке, в котором окна переданы в конструктор
+    std::vector<RequestWindowStatistics> GetStatistics(Clock::time_point now) const;
+private:
+    using LatencyBuckets = LogLinearBuckets<3>;
+
+    struct Bucket {
+        std::mutex reset_mutex;
+        std::atomic<uint64_t> epoch{ UNUSED_EPOCH }; //номер интервала, к которому относятся счётчики
+        std::atomic<uint32_t> requests{ 0 };
+        std::atomic<uint32_t> no_result_requests{ 0 };
+        std::array<std::atomic<uint32_t>, LatencyBuckets::COUNT> latencies{};
+    };
+
+    static constexpr uint64_t UNUSED_EPOCH = UINT64_MAX;
+
+    std::vector<std::chrono::seconds> windows_;
+    std::vector<uint64_t> window_buckets_; //число интервалов в каждом окне
+    const std::chrono::nanoseconds bucket_width_;
+    size_t bucket_count_ = 0;
+    std::unique_ptr<Bucket[]> buckets_;
+
+    uint64_t GetEpoch(Clock::time_point time) const;
+
+    // Возвращает nullptr, если интервал уже занят более поздним временем
+    Bucket* AcquireBucket(uint64_t epoch);
+};
@@ -1,4 +1,6 @@
 #include "search_server.h"
+#include <cstring>
+#include <exception>
 
 SearchServer::SearchServer(const std::string& text) : SearchServer(SplitIntoWords(text)) {
 }
@@ -8,28 +10,166 @@ SearchServer::SearchServer(const std::string_view& text) : SearchServer(SplitInt
 
 void SearchServer::AddDocument(int document_id, std::string_view document_, DocumentStatus status,
     const std::vector<int>& ratings) {
-    storage.emplace_back(document_);
-    if (document_id < 0 || documents_.count(document_id) != 0 || !IsValidWord(storage.back())) {
-        throw std::invalid_argument("Invalid document data"s);
+    STAGE_TIMER("search_server.add_document");
+    // Текст документа не хранится: слова копируются в словарь, а индекс ссылается на них по id
+    std::vector<PreparedDocument> documents;
+    documents.push_back(PrepareDocument(document_id, document_, status, ratings));
+    CommitDocuments(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    AddDocuments(PrepareDocuments(documents));
+}
+
+std::vector<SearchServer::PreparedDocument> SearchServer::PrepareDocuments(const std::vector<DocumentInput>& documents) const {
+    std::vector<PreparedDocument> prepared_documents(documents.size());
+    std::transform(std::execution::par, documents.begin(), documents.end(), prepared_documents.begin(),
+        [this](const DocumentInput& document) {
+            return PrepareDocument(document.id, document.text, document.status, document.ratings); });
+    return prepared_documents;
+}
+
+void SearchServer::AddDocuments(std::vector<PreparedDocument>&& documents) {
+    STAGE_TIMER("search_server.add_documents");
+    CommitDocuments(std::execution::par, documents);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+    size_t top_k) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status, top_k);
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+    DocumentStatus status, size_t top_k) const {
+    const std::vector<BatchQuery> queries = PrepareBatchQueries(raw_queries);
+    std::vector<std::vector<Document>> results(queries.size());
+    std::vector<size_t> indexes(queries.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](const size_t i) {
+        TopDocumentsCollector top_documents(top_k);
+        FindTopDocumentsWithStatus(std::execution::seq, queries[i].query, queries[i].idfs, status, top_documents);
+        results[i] = top_documents.Extract();
+        });
+    return results;
+}
+
+void SearchServer::FindTopDocumentsBatchJoined(const std::vector<std::string>& raw_queries,
+    std::vector<Document>& documents, std::vector<size_t>& offsets, DocumentStatus status, size_t top_k) const {
+    const std::vector<BatchQuery> queries = PrepareBatchQueries(raw_queries);
+    // Результат запроса не длиннее top_k и числа документов; обычно запросы заполняют свои места целиком
+    const size_t capacity = std::min(top_k, GetDocumentCount());
+    documents.resize(queries.size() * capacity);
+    std::vector<size_t> counts(queries.size());
+    std::vector<size_t> indexes(queries.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](const size_t i) {
+        TopDocumentsCollector top_documents(top_k);
+        FindTopDocumentsWithStatus(std::execution::seq, queries[i].query, queries[i].idfs, status, top_documents);
+        counts[i] = top_documents.ExtractTo(documents.data() + i * capacity);
+        });
+
+    offsets.assign(queries.size() + 1, 0);
+    std::partial_sum(counts.begin(), counts.end(), std::next(offsets.begin()));
+    // offsets[i] <= i * capacity, поэтому сдвиг к началу не затирает ещё не перенесённые результаты
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (offsets[i] != i * capacity) {
+            std::move(documents.begin() + i * capacity, documents.begin() + i * capacity + counts[i],
+                documents.begin() + offsets[i]);
+        }
+    }
+    documents.resize(offsets.back());
+}
+
+std::vector<SearchServer::BatchQuery> SearchServer::PrepareBatchQueries(const std::vector<std::string>& raw_queries) const {
+    std::vector<size_t> indexes(raw_queries.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    // Исключение из параллельного алгоритма завершило бы программу, поэтому ошибки разбора собираются
+    // и первая из них передаётся вызывающему
+    std::vector<BatchQuery> queries(raw_queries.size());
+    std::vector<std::exception_ptr> errors(raw_queries.size());
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](const size_t i) {
+        try {
+            queries[i].query = ParseQuery(raw_queries[i]);
+        }
+        catch (...) {
+            errors[i] = std::current_exception();
+        }
+        });
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
     }
-    const std::vector<std::string_view> words = SplitIntoWordsNoStop(storage.back());
-    const double inv_word_count = 1.0 / words.size();
-    for (const std::string_view& word : words) {
-        documents_freqs_[word][document_id] += inv_word_count;
-        documents_[document_id].word_frequencies[word] += inv_word_count;
+
+    std::vector<uint32_t> terms;
+    for (const BatchQuery& query : queries) {
+        terms.insert(terms.end(), query.query.plus_words_.begin(), query.query.plus_words_.end());
     }
-    documents_[document_id].rating = ComputeAverageRating(ratings);
-    documents_[document_id].status = status;
-    documents_ids_.emplace(document_id);
+    std::sort(std::execution::par, terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    std::vector<double> term_idfs(terms.size());
+    std::transform(std::execution::par, terms.begin(), terms.end(), term_idfs.begin(),
+        [this](const uint32_t term_id) { return ComputeIdf(term_id); });
+
+    std::for_each(std::execution::par, queries.begin(), queries.end(), [&](BatchQuery& query) {
+        const std::vector<uint32_t>& plus_words = query.query.plus_words_;
+        query.idfs.resize(plus_words.size());
+        std::transform(plus_words.begin(), plus_words.end(), query.idfs.begin(), [&](const uint32_t term_id) {
+            return term_idfs[std::lower_bound(terms.begin(), terms.end(), term_id) - terms.begin()]; });
+        });
+    return queries;
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(std::execution::seq, raw_query, [status](int document_id, DocumentStatus status_, int rating) {
-        return status_ == status; });
+SearchServer SearchServer::Clone() const {
+    SearchServer clone(stop_words_);
+    // Слова подготовленных документов ссылаются на словарь этого сервера и копируются в словарь копии при добавлении
+    std::vector<PreparedDocument> documents;
+    documents.reserve(documents_ids_.size());
+    for (const int document_id : documents_ids_) {
+        const uint32_t slot = document_slots_.at(document_id);
+        PreparedDocument& document = documents.emplace_back();
+        document.id = document_id;
+        document.status = slot_statuses_[slot];
+        document.rating = slot_ratings_[slot];
+        document.is_valid = true;
+        document.inv_word_count = slot_inv_word_counts_[slot];
+        for (const auto [term_id, count] : slot_word_frequencies_[slot]) {
+            document.word_counts.emplace_back(terms_.GetTerm(term_id), count);
+        }
+        std::sort(document.word_counts.begin(), document.word_counts.end());
+    }
+    if (!documents.empty()) {
+        clone.AddDocuments(std::move(documents));
+    }
+    clone.retrieval_mode_ = retrieval_mode_;
+    if (query_cache_) {
+        clone.EnableQueryCache(query_cache_->GetCapacity());
+    }
+    return clone;
 }
 
 size_t SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return document_slots_.size();
+}
+
+void SearchServer::SetRetrievalMode(RetrievalMode mode) {
+    retrieval_mode_ = mode;
+}
+
+RetrievalMode SearchServer::GetRetrievalMode() const {
+    return retrieval_mode_;
+}
+
+void SearchServer::EnableQueryCache(size_t capacity) {
+    query_cache_ = std::make_unique<QueryCache>(capacity);
+}
+
+void SearchServer::DisableQueryCache() {
+    query_cache_.reset();
+}
+
+const QueryCache* SearchServer::GetQueryCache() const {
+    return query_cache_.get();
 }
 
 MatchedDocument SearchServer::MatchDocument(std::string_view raw_query,
@@ -39,59 +179,60 @@ MatchedDocument SearchServer::MatchDocument(std::string_view raw_query,
 
 MatchedDocument SearchServer::MatchDocument(Sequenced, std::string_view raw_query,
     int document_id) const {
+    STAGE_TIMER("search_server.match_document.seq");
     const QueryContent query = ParseQuery(raw_query);
+    const uint32_t slot = document_slots_.at(document_id);
     std::vector<std::string_view> matched_words;
-    for (std::string_view word : query.minus_words_) {
-        if (documents_freqs_.count(word) != 0) {
-            if (documents_freqs_.at(word).count(document_id)) {
-                return { matched_words, documents_.at(document_id).status };
-            }
+    for (const uint32_t term_id : query.minus_words_) {
+        if (documents_freqs_[term_id].Contains(slot)) {
+            return { matched_words, slot_statuses_[slot] };
         }
     }
-    for (std::string_view word : query.plus_words_) {
-        if (documents_freqs_.count(word) != 0) {
-            if (documents_freqs_.at(word).count(document_id)) {
-                matched_words.push_back(word);
-            }
+    for (const uint32_t term_id : query.plus_words_) {
+        if (documents_freqs_[term_id].Contains(slot)) {
+            matched_words.push_back(terms_.GetTerm(term_id));
         }
     }
-    return { matched_words, documents_.at(document_id).status };
+    std::sort(matched_words.begin(), matched_words.end());
+    return { matched_words, slot_statuses_[slot] };
 }
 
 MatchedDocument SearchServer::MatchDocument(Parallel, std::string_view raw_query,
     int document_id) const {
+    STAGE_TIMER("search_server.match_document.par");
     std::vector<std::string_view> matched_words;
     const QueryContent query = ParseQuery(raw_query, true);
+    const uint32_t slot = document_slots_.at(document_id);
     if (std::any_of(std::execution::par,
         query.minus_words_.begin(), query.minus_words_.end(),
-        [&](std::string_view word) {
-            return documents_freqs_.count(word) != 0 && documents_freqs_.at(word).count(document_id);
+        [&](const uint32_t term_id) {
+            return documents_freqs_[term_id].Contains(slot);
         })) {
-            return { matched_words, documents_.at(document_id).status };
+            return { matched_words, slot_statuses_[slot] };
     }
-    matched_words.resize(query.plus_words_.size());
+    std::vector<uint32_t> matched_terms(query.plus_words_.size());
     auto it = std::copy_if(std::execution::par,
         query.plus_words_.begin(), query.plus_words_.end(),
-        matched_words.begin(),
-        [&](std::string_view word) {
-            return documents_freqs_.count(word) != 0 && documents_freqs_.at(word).count(document_id);
+        matched_terms.begin(),
+        [&](const uint32_t term_id) {
+            return documents_freqs_[term_id].Contains(slot);
         });
-    std::sort(std::execution::par, matched_words.begin(), it);
-    matched_words.erase(std::unique(std::execution::par, matched_words.begin(), it), matched_words.end());
-    return { matched_words, documents_.at(document_id).status };
+    std::sort(std::execution::par, matched_terms.begin(), it);
+    matched_terms.erase(std::unique(std::execution::par, matched_terms.begin(), it), matched_terms.end());
+    matched_words.reserve(matched_terms.size());
+    for (const uint32_t term_id : matched_terms) {
+        matched_words.push_back(terms_.GetTerm(term_id));
+    }
+    std::sort(matched_words.begin(), matched_words.end());
+    return { matched_words, slot_statuses_[slot] };
 }
 
 bool SearchServer::IsValidWord(std::string_view word) const {
     // A valid word must not contain special characters
-    return std::none_of(word.begin(), word.end(), [](char c) {
-        return c >= '\0' && c < ' ';
-        });
+    return !ContainsControlCharacters(word);
 }
 
 SearchServer::QueryWordContent SearchServer::IsMinusWord(std::string_view word) const {
-    if (!IsValidWord(word)) {
-        throw std::invalid_argument("This word is invalid"s);
-    }
     if (word[0] == '-') {
         const std::string_view new_word = word.substr(1);
         if (new_word.empty() || new_word[0] == '-') {
@@ -103,30 +244,53 @@ SearchServer::QueryWordContent SearchServer::IsMinusWord(std::string_view word)
 }
 
 bool SearchServer::IsStopWord(std::string_view word) const {
-    return stop_words_.count(word) > 0;
+    return stop_word_set_.Contains(word);
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string& text) const {
-    std::vector<std::string_view> words;
-    for (const std::string_view& word : SplitIntoWordsView(text)) {
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+SearchServer::PreparedDocument SearchServer::PrepareDocument(int document_id, std::string_view document_,
+    DocumentStatus status, const std::vector<int>& ratings) const {
+    // Проверка символов и разбиение на слова выполняются за один проход; буфер слов переиспользуется потоком
+    thread_local std::vector<std::string_view> words;
+    PreparedDocument document{ document_id, status, ComputeAverageRating(ratings),
+        SplitIntoValidWordsView(document_, words), {} };
+    if (!document.is_valid) {
+        return document;
+    }
+    words.erase(std::remove_if(words.begin(), words.end(),
+        [this](const std::string_view word) { return IsStopWord(word); }), words.end());
+    document.inv_word_count = 1.0 / words.size();
+    std::sort(words.begin(), words.end());
+    for (const std::string_view word : words) {
+        if (document.word_counts.empty() || document.word_counts.back().first != word) {
+            document.word_counts.emplace_back(word, 0);
         }
+        ++document.word_counts.back().second;
     }
-    return words;
+    return document;
 }
 
 SearchServer::QueryContent SearchServer::ParseQuery(std::string_view text, bool if_par) const {
+    STAGE_TIMER("search_server.parse_query");
     QueryContent query;
-    for (std::string_view word : SplitIntoWordsView(text)) {
+    thread_local std::vector<std::string_view> words;
+    if (!SplitIntoValidWordsView(text, words)) {
+        throw std::invalid_argument("This word is invalid"s);
+    }
+    for (const std::string_view word : words) {
         QueryWordContent element = IsMinusWord(word);
-        if (!element.IsStop) {
-            if (element.IsMinus) {
-                query.minus_words_.push_back(element.word);
-            }
-            else {
-                query.plus_words_.push_back(element.word);
-            }
+        if (element.IsStop) {
+            continue;
+        }
+        // Слова, которых нет в словаре, не встречаются ни в одном документе и на результат не влияют
+        const uint32_t term_id = terms_.Find(element.word);
+        if (term_id == TermDictionary::NO_TERM) {
+            continue;
+        }
+        if (element.IsMinus) {
+            query.minus_words_.push_back(term_id);
+        }
+        else {
+            query.plus_words_.push_back(term_id);
         }
     }
     if (!if_par) {
@@ -144,8 +308,118 @@ std::set<int>::const_iterator SearchServer::end() const {
     return SearchServer::documents_ids_.end();
 }
 
-double SearchServer::ComputeIdf(std::string_view word) const {
-    return log((GetDocumentCount() * 1.0) / documents_freqs_.at(word).size());
+SearchServer::ExcludedSlots::ExcludedSlots(SlotBitmap bitmap) :
+        is_sparse_(false),
+        bitmap_(std::move(bitmap)) {
+}
+
+SearchServer::ExcludedSlots::ExcludedSlots(std::vector<uint32_t> slots) :
+        slots_(std::move(slots)) {
+}
+
+SearchServer::ExcludedSlots SearchServer::GetExcludedSlots(const QueryContent& query) const {
+    size_t posting_count = 0;
+    for (const uint32_t term_id : query.minus_words_) {
+        posting_count += documents_freqs_[term_id].size();
+    }
+    if (posting_count == 0) {
+        return {};
+    }
+    const size_t slot_count = slot_document_ids_.size();
+    if (posting_count < slot_count / 64) {
+        std::vector<uint32_t> slots;
+        slots.reserve(posting_count);
+        for (const uint32_t term_id : query.minus_words_) {
+            documents_freqs_[term_id].ForEach([&slots](const uint32_t slot, uint32_t) { slots.push_back(slot); });
+        }
+        // Список каждого слова отсортирован, поэтому для одного минус-слова сортировка не нужна
+        if (query.minus_words_.size() > 1) {
+            std::sort(slots.begin(), slots.end());
+            slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+        }
+        return ExcludedSlots(std::move(slots));
+    }
+    SlotBitmap excluded(slot_count);
+    for (const uint32_t term_id : query.minus_words_) {
+        documents_freqs_[term_id].ForEach([&excluded](const uint32_t slot, uint32_t) { excluded.Set(slot); });
+    }
+    return ExcludedSlots(std::move(excluded));
+}
+
+double SearchServer::ComputeIdf(uint32_t term_id) const {
+    return idfs_.Get(term_id, generation_, [this, term_id]() {
+        return log((GetDocumentCount() * 1.0) / documents_freqs_[term_id].size());
+        });
+}
+
+std::vector<double> SearchServer::ComputeIdfs(const QueryContent& query) const {
+    std::vector<double> idfs(query.plus_words_.size());
+    std::transform(query.plus_words_.begin(), query.plus_words_.end(), idfs.begin(),
+        [this](const uint32_t term_id) { return ComputeIdf(term_id); });
+    return idfs;
+}
+
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < ALLOWABLE_ERROR) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+SearchServer::TopDocumentsCollector::TopDocumentsCollector(size_t top_k) :
+        top_k_(top_k) {
+    heap_.reserve(std::min<size_t>(top_k_, 1024));
+}
+
+void SearchServer::TopDocumentsCollector::Add(const Document& document) {
+    if (heap_.size() < top_k_) {
+        heap_.push_back(document);
+        std::push_heap(heap_.begin(), heap_.end(), IsBetter);
+    }
+    else if (top_k_ != 0 && IsBetter(document, heap_.front())) {
+        std::pop_heap(heap_.begin(), heap_.end(), IsBetter);
+        heap_.back() = document;
+        std::push_heap(heap_.begin(), heap_.end(), IsBetter);
+    }
+}
+
+bool SearchServer::TopDocumentsCollector::IsFull() const {
+    return top_k_ != 0 && heap_.size() == top_k_;
+}
+
+size_t SearchServer::TopDocumentsCollector::GetTopK() const {
+    return top_k_;
+}
+
+const Document& SearchServer::TopDocumentsCollector::GetWorst() const {
+    return heap_.front();
+}
+
+std::vector<Document> SearchServer::TopDocumentsCollector::Extract() {
+    STAGE_TIMER("search_server.select_top_documents");
+    std::sort(heap_.begin(), heap_.end(), IsBetter);
+    return std::move(heap_);
+}
+
+size_t SearchServer::TopDocumentsCollector::ExtractTo(Document* output) {
+    STAGE_TIMER("search_server.select_top_documents");
+    std::sort(heap_.begin(), heap_.end(), IsBetter);
+    std::move(heap_.begin(), heap_.end(), output);
+    const size_t count = heap_.size();
+    heap_.clear();
+    return count;
+}
+
+void SearchServer::TopDocumentsCollector::Assign(std::vector<Document> documents) {
+    heap_ = std::move(documents);
+    std::make_heap(heap_.begin(), heap_.end(), IsBetter);
+}
+
+bool SearchServer::TopDocumentsCollector::IsBetter(const Document& lhs, const Document& rhs) {
+    if (IsMoreRelevant(lhs, rhs)) {
+        return true;
+    }
+    return !IsMoreRelevant(rhs, lhs) && lhs.id < rhs.id;
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -156,13 +430,28 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static const std::map<std::string_view, double> empty_map;
-    auto it = documents_.lower_bound(document_id);
-    if (it != documents_.end()) {
-        return documents_.at(document_id).word_frequencies;
+std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    std::map<std::string_view, double> result;
+    auto it = document_slots_.find(document_id);
+    if (it != document_slots_.end()) {
+        for (const auto [term_id, count] : slot_word_frequencies_[it->second]) {
+            result.emplace(terms_.GetTerm(term_id), GetTermFreq(it->second, count));
+        }
+    }
+    return result;
+}
+
+std::vector<uint32_t> SearchServer::GetTermIds(int document_id) const {
+    std::vector<uint32_t> result;
+    auto it = document_slots_.find(document_id);
+    if (it != document_slots_.end()) {
+        const auto& word_frequencies = slot_word_frequencies_[it->second];
+        result.reserve(word_frequencies.size());
+        for (const auto [term_id, _] : word_frequencies) {
+            result.push_back(term_id);
+        }
     }
-    return empty_map;
+    return result;
 }
 
 void SearchServer::RemoveDocument(int document_id) {
@@ -173,12 +462,14 @@ void SearchServer::RemoveDocument(int document_id) {
 }
 
 void SearchServer::RemoveDocument(Sequenced, int document_id) {
+    const uint32_t slot = document_slots_.at(document_id);
     documents_ids_.erase(document_id);
-    auto it = documents_.find(document_id);
-    for (auto& [word, freq] : it->second.word_frequencies) {
-        documents_freqs_[word].erase(documents_freqs_[word].find(it->first));
+    ++generation_;
+    for (const auto [term_id, _] : slot_word_frequencies_[slot]) {
+        documents_freqs_[term_id].Erase(slot);
     }
-    documents_.erase(document_id);
+    ReleaseUnusedTerms(slot_word_frequencies_[slot]);
+    FreeSlot(slot);
     return;
 }
 
@@ -187,27 +478,316 @@ void SearchServer::RemoveDocument(Parallel, int document_id) {
         return;
     }
     documents_ids_.erase(document_id);
+    ++generation_;
 
-    std::vector<const std::string*> words(documents_.at(document_id).word_frequencies.size());
-    std::transform(std::execution::par,
-        documents_[document_id].word_frequencies.begin(), documents_[document_id].word_frequencies.end(),
-        words.begin(),
-        [&](const auto& element) { static std::string tmp(element.first); return &tmp; });
+    const uint32_t slot = document_slots_.at(document_id);
+    const auto& word_frequencies = slot_word_frequencies_[slot];
+    std::vector<PostingList*> postings(word_frequencies.size());
+    std::transform(word_frequencies.begin(), word_frequencies.end(),
+        postings.begin(),
+        [&](const TermFrequency& element) { return &documents_freqs_[element.term_id]; });
     std::for_each(std::execution::par,
-        words.begin(), words.end(),
-        [&](const std::string* word) { auto it = documents_.find(document_id);
-    documents_freqs_[*word].erase(documents_freqs_[*word].find(it->first)); });
+        postings.begin(), postings.end(),
+        [slot](PostingList* word_postings) { word_postings->Erase(slot); });
+    ReleaseUnusedTerms(word_frequencies);
 
-    documents_.erase(document_id);
+    FreeSlot(slot);
     return;
 }
 
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    STAGE_TIMER("search_server.remove_documents");
+    std::vector<uint32_t> slots;
+    for (const int document_id : document_ids) {
+        if (documents_ids_.erase(document_id) != 0) {
+            slots.push_back(document_slots_.at(document_id));
+        }
+    }
+    if (slots.empty()) {
+        return;
+    }
+    ++generation_;
+    std::sort(slots.begin(), slots.end());
+
+    // Пары (слово, ячейка), упорядоченные по слову, а внутри слова - по ячейке
+    std::vector<std::pair<uint32_t, uint32_t>> term_slots;
+    for (const uint32_t slot : slots) {
+        for (const auto [term_id, _] : slot_word_frequencies_[slot]) {
+            term_slots.emplace_back(term_id, slot);
+        }
+    }
+    std::sort(std::execution::par, term_slots.begin(), term_slots.end());
+    std::vector<uint32_t> erased_slots(term_slots.size());
+    std::vector<size_t> term_begins;
+    for (size_t i = 0; i < term_slots.size(); ++i) {
+        erased_slots[i] = term_slots[i].second;
+        if (i == 0 || term_slots[i].first != term_slots[i - 1].first) {
+            term_begins.push_back(i);
+        }
+    }
+    term_begins.push_back(term_slots.size());
+
+    std::vector<size_t> terms(term_begins.size() - 1);
+    std::iota(terms.begin(), terms.end(), 0);
+    std::for_each(std::execution::par, terms.begin(), terms.end(), [&](const size_t term) {
+        documents_freqs_[term_slots[term_begins[term]].first].Erase(
+            erased_slots.data() + term_begins[term], erased_slots.data() + term_begins[term + 1]);
+    });
+    for (const size_t term : terms) {
+        const uint32_t term_id = term_slots[term_begins[term]].first;
+        if (documents_freqs_[term_id].empty()) {
+            terms_.Release(term_id);
+        }
+    }
+    for (const uint32_t slot : slots) {
+        FreeSlot(slot);
+    }
+}
+
+bool SearchServer::CompactTerms() {
+    // Переносить слова имеет смысл, только когда освобождённых байт больше живых: тогда перенос окупается
+    if (terms_.GetReleasedBytes() <= terms_.GetLiveBytes()) {
+        return false;
+    }
+    terms_.Compact();
+    return true;
+}
+
+void SearchServer::ReleaseUnusedTerms(const FlatArray<TermFrequency>& word_frequencies) {
+    // Слова, которые больше не встречаются ни в одном документе, удаляются из словаря вместе с их текстом
+    for (const auto [term_id, _] : word_frequencies) {
+        if (documents_freqs_[term_id].empty()) {
+            terms_.Release(term_id);
+        }
+    }
+}
+
+uint32_t SearchServer::AllocateSlot(int document_id) {
+    uint32_t slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else {
+        slot = static_cast<uint32_t>(slot_document_ids_.size());
+        slot_document_ids_.push_back(FREE_SLOT);
+        slot_ratings_.push_back(0);
+        slot_statuses_.push_back(DocumentStatus::ACTUAL);
+        slot_word_frequencies_.emplace_back();
+        slot_inv_word_counts_.push_back(0.0);
+        for (SlotBitmap& status_slots : status_slots_) {
+            status_slots.Resize(slot_document_ids_.size());
+        }
+    }
+    slot_document_ids_[slot] = document_id;
+    document_slots_[document_id] = slot;
+    return slot;
+}
+
+void SearchServer::FreeSlot(uint32_t slot) {
+    document_slots_.erase(slot_document_ids_[slot]);
+    slot_document_ids_[slot] = FREE_SLOT;
+    status_slots_[static_cast<size_t>(slot_statuses_[slot])].Reset(slot);
+    slot_word_frequencies_[slot] = {};
+    free_slots_.push_back(slot);
+}
+
+void SearchServer::SetSlotStatus(uint32_t slot, DocumentStatus status) {
+    status_slots_[static_cast<size_t>(slot_statuses_[slot])].Reset(slot);
+    slot_statuses_[slot] = status;
+    status_slots_[static_cast<size_t>(status)].Set(slot);
+}
+
+double SearchServer::GetTermFreq(uint32_t slot, uint32_t count) const {
+    return count * slot_inv_word_counts_[slot];
+}
+
+namespace {
+// Записывает элементы всех списков подряд; у структур списков нет выравнивающих байт,
+// поэтому снимок одного и того же индекса всегда одинаков
+template <typename Lists, typename GetList>
+void WriteConcatenated(SnapshotWriter& writer, const Lists& lists, GetList get_list) {
+    for (const auto& element : lists) {
+        const auto& list = get_list(element);
+        writer.WriteArray(list.data(), list.size());
+    }
+}
+
+// Смещения начала каждого списка и общий размер: count + 1 значений
+template <typename Lists, typename GetSize>
+void WriteOffsets(SnapshotWriter& writer, const Lists& lists, GetSize get_size) {
+    uint64_t offset = 0;
+    writer.WriteValue(offset);
+    for (const auto& element : lists) {
+        offset += get_size(element);
+        writer.WriteValue(offset);
+    }
+}
+}
+
+void SearchServer::SaveSnapshot(const std::string& path) const {
+    SnapshotWriter writer(path);
+
+    writer.WriteValue<uint64_t>(stop_words_.size());
+    for (const std::string& word : stop_words_) {
+        writer.WriteValue<uint64_t>(word.size());
+        writer.Write(word.data(), word.size());
+    }
+    writer.Align();
+
+    const size_t term_count = terms_.size();
+    uint64_t term_offset = 0;
+    writer.WriteValue<uint64_t>(term_count);
+    writer.WriteValue(term_offset);
+    for (uint32_t term_id = 0; term_id < term_count; ++term_id) {
+        term_offset += terms_.GetTerm(term_id).size();
+        writer.WriteValue(term_offset);
+    }
+    for (uint32_t term_id = 0; term_id < term_count; ++term_id) {
+        const std::string_view term = terms_.GetTerm(term_id);
+        writer.Write(term.data(), term.size());
+    }
+    writer.Align();
+
+    const size_t slot_count = slot_document_ids_.size();
+    writer.WriteValue<uint64_t>(slot_count);
+    writer.WriteArray(slot_document_ids_.data(), slot_count);
+    writer.WriteArray(slot_ratings_.data(), slot_count);
+    for (const DocumentStatus status : slot_statuses_) {
+        writer.WriteValue(static_cast<int32_t>(status));
+    }
+    writer.Align();
+
+    writer.WriteArray(slot_inv_word_counts_.data(), slot_count);
+    const auto get_list = [](const auto& list) -> const auto& { return list; };
+    WriteOffsets(writer, slot_word_frequencies_, [](const auto& list) { return list.size(); });
+    WriteConcatenated(writer, slot_word_frequencies_, get_list);
+    writer.Align();
+
+    // Списки вхождений сохраняются в сжатом виде: заголовки блоков и упакованные данные каждого слова
+    const PostingList empty_postings;
+    std::vector<const PostingList*> postings(term_count, &empty_postings);
+    for (uint32_t term_id = 0; term_id < term_count && term_id < documents_freqs_.size(); ++term_id) {
+        postings[term_id] = &documents_freqs_[term_id];
+    }
+    WriteOffsets(writer, postings, [](const PostingList* list) { return list->GetBlocks().size(); });
+    WriteOffsets(writer, postings, [](const PostingList* list) { return list->GetData().size(); });
+    for (const PostingList* list : postings) {
+        writer.WriteValue(list->GetMaxTermFreq());
+    }
+    WriteConcatenated(writer, postings, [](const PostingList* list) -> const auto& { return list->GetBlocks(); });
+    WriteConcatenated(writer, postings, [](const PostingList* list) -> const auto& { return list->GetData(); });
+    writer.Align();
+
+    writer.Finish(sizeof(PostingBlock), sizeof(TermFrequency));
+}
+
+SearchServer SearchServer::LoadSnapshot(const std::string& path) {
+    SearchServer server;
+    server.snapshot_ = std::make_shared<MappedFile>(path);
+    SnapshotReader reader(*server.snapshot_, sizeof(PostingBlock), sizeof(TermFrequency));
+    // Смещения секций проверяются, чтобы повреждённый снимок не приводил к чтению за пределами файла
+    const auto check_offsets = [](const uint64_t* offsets, size_t count, uint64_t total) {
+        for (size_t i = 0; i < count; ++i) {
+            if (offsets[i] > offsets[i + 1]) {
+                throw std::invalid_argument("Snapshot is corrupted"s);
+            }
+        }
+        if (offsets[0] != 0 || offsets[count] != total) {
+            throw std::invalid_argument("Snapshot is corrupted"s);
+        }
+    };
+
+    const uint64_t stop_word_count = reader.ReadValue<uint64_t>();
+    for (uint64_t i = 0; i < stop_word_count; ++i) {
+        const uint64_t size = reader.ReadValue<uint64_t>();
+        server.stop_words_.emplace(reader.ReadBytes(size));
+    }
+    server.stop_word_set_ = StopWordSet(server.stop_words_);
+    reader.Align();
+
+    const uint64_t term_count = reader.ReadValue<uint64_t>();
+    const uint64_t* term_offsets = reader.ReadArray<uint64_t>(term_count + 1);
+    const std::string_view term_blob = reader.ReadBytes(term_offsets[term_count]);
+    check_offsets(term_offsets, term_count, term_blob.size());
+    std::vector<std::string_view> terms(term_count);
+    for (uint64_t term_id = 0; term_id < term_count; ++term_id) {
+        terms[term_id] = term_blob.substr(term_offsets[term_id], term_offsets[term_id + 1] - term_offsets[term_id]);
+    }
+    server.terms_.Restore(terms);
+    reader.Align();
+
+    const uint64_t slot_count = reader.ReadValue<uint64_t>();
+    const int32_t* document_ids = reader.ReadArray<int32_t>(slot_count);
+    const int32_t* ratings = reader.ReadArray<int32_t>(slot_count);
+    const int32_t* statuses = reader.ReadArray<int32_t>(slot_count);
+    reader.Align();
+    server.slot_document_ids_.assign(document_ids, document_ids + slot_count);
+    server.slot_ratings_.assign(ratings, ratings + slot_count);
+    server.slot_statuses_.resize(slot_count);
+    server.document_slots_.reserve(slot_count);
+    for (SlotBitmap& status_slots : server.status_slots_) {
+        status_slots.Resize(slot_count);
+    }
+    for (uint32_t slot = 0; slot < slot_count; ++slot) {
+        if (statuses[slot] < 0 || statuses[slot] >= static_cast<int32_t>(DOCUMENT_STATUS_COUNT)) {
+            throw std::invalid_argument("Snapshot is corrupted"s);
+        }
+        server.slot_statuses_[slot] = static_cast<DocumentStatus>(statuses[slot]);
+        if (document_ids[slot] == FREE_SLOT) {
+            server.free_slots_.push_back(slot);
+        }
+        else {
+            server.status_slots_[statuses[slot]].Set(slot);
+            server.document_slots_.emplace(document_ids[slot], slot);
+            server.documents_ids_.emplace_hint(server.documents_ids_.end(), document_ids[slot]);
+        }
+    }
+
+    const double* inv_word_counts = reader.ReadArray<double>(slot_count);
+    server.slot_inv_word_counts_.assign(inv_word_counts, inv_word_counts + slot_count);
+    const uint64_t* entry_offsets = reader.ReadArray<uint64_t>(slot_count + 1);
+    const TermFrequency* word_frequencies = reader.ReadArray<TermFrequency>(entry_offsets[slot_count]);
+    check_offsets(entry_offsets, slot_count, entry_offsets[slot_count]);
+    reader.Align();
+    server.slot_word_frequencies_.reserve(slot_count);
+    for (uint64_t slot = 0; slot < slot_count; ++slot) {
+        server.slot_word_frequencies_.push_back(FlatArray<TermFrequency>::Borrow(
+            word_frequencies + entry_offsets[slot], entry_offsets[slot + 1] - entry_offsets[slot]));
+    }
+
+    const uint64_t* block_offsets = reader.ReadArray<uint64_t>(term_count + 1);
+    const uint64_t* data_offsets = reader.ReadArray<uint64_t>(term_count + 1);
+    const double* max_term_freqs = reader.ReadArray<double>(term_count);
+    const PostingBlock* blocks = reader.ReadArray<PostingBlock>(block_offsets[term_count]);
+    const uint32_t* data = reader.ReadArray<uint32_t>(data_offsets[term_count]);
+    check_offsets(block_offsets, term_count, block_offsets[term_count]);
+    check_offsets(data_offsets, term_count, data_offsets[term_count]);
+    reader.Align();
+    server.documents_freqs_.reserve(term_count);
+    server.idfs_.Resize(term_count);
+    for (uint64_t term_id = 0; term_id < term_count; ++term_id) {
+        server.documents_freqs_.emplace_back(
+            FlatArray<PostingBlock>::Borrow(blocks + block_offsets[term_id], block_offsets[term_id + 1] - block_offsets[term_id]),
+            FlatArray<uint32_t>::Borrow(data + data_offsets[term_id], data_offsets[term_id + 1] - data_offsets[term_id]),
+            max_term_freqs[term_id]);
+        // Распаковка блоков не проверяет границы, поэтому заголовки из файла проверяются заранее
+        if (!server.documents_freqs_.back().IsConsistent()) {
+            throw std::invalid_argument("Snapshot is corrupted"s);
+        }
+    }
+    if (!reader.AtEnd()) {
+        throw std::invalid_argument("Snapshot is corrupted"s);
+    }
+    return server;
+}
+
 void AddDocument(SearchServer& search_server, int document_id, std::string_view raw_query, DocumentStatus status,
     const std::vector<int>& ratings) {
     search_server.AddDocument(document_id, raw_query, status, ratings);
 }
 
-void SearchServer::RemoveDuplicatesWords(std::vector<std::string_view>& words) const {
+void SearchServer::RemoveDuplicatesWords(std::vector<uint32_t>& words) const {
     std::sort(words.begin(), words.end());
     words.erase(std::unique(words.begin(), words.end()), words.end());
 }
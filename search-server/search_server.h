@@ -1,16 +1,29 @@
 #pragma once
 #include <cmath>
-#include <deque>
 #include <map>
 #include <string>
 #include <string_view>
 #include <algorithm>
+#include <array>
 #include <execution>
 #include <future>
-#include "concurrent_map.h"
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include "document.h"
+#include "flat_array.h"
+#include "idf_cache.h"
+#include "posting_list.h"
+#include "query_cache.h"
 #include "read_input_functions.h"
+#include "slot_bitmap.h"
+#include "snapshot.h"
+#include "stage_metrics.h"
+#include "stop_word_set.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
 #include "log_duration.h"
 
 
@@ -25,8 +38,34 @@ const int MAX_RESULT_DOCUMENT_COUNT = 5;
 
 const double ALLOWABLE_ERROR = 1e-6;
 
+// Параллельный поиск делит диапазон внутренних номеров документов на блоки не длиннее этого значения
+const int MAX_PARALLEL_BLOCK_SPAN = 1 << 16;
+
+// Документ для пакетного добавления (SearchServer::AddDocuments); текст должен оставаться доступным до конца добавления
+struct DocumentInput {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+// Способ поиска лучших документов в последовательной версии FindTopDocuments
+enum class RetrievalMode {
+    EXHAUSTIVE, // вычисляется релевантность всех документов, содержащих плюс-слова
+    MAX_SCORE,  // динамическое отсечение документов, которые не могут попасть в top_k (алгоритм MaxScore)
+};
+
 class SearchServer {
 public:
+    // Разобранный документ: слова ещё не добавлены в словарь и ссылаются на исходный текст
+    struct PreparedDocument {
+        int id = 0;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        int rating = 0;
+        bool is_valid = false;
+        std::vector<std::pair<std::string_view, uint32_t>> word_counts; //слово -> число вхождений, отсортированы по слову
+        double inv_word_count = 0.0; //1 / число слов документа без стоп-слов
+    };
 
     template <typename StringContainer>
     SearchServer(const StringContainer& text);
@@ -35,24 +74,71 @@ public:
 
     SearchServer(const std::string_view& text);
 
+    // Сервер не копируется: словарь хранит слова в TextArena, на которую ссылаются выданные string_view,
+    // а кэш запросов принадлежит серверу. Перемещение сохраняет адреса слов, поэтому разрешено
+    SearchServer(const SearchServer&) = delete;
+    SearchServer& operator=(const SearchServer&) = delete;
+    SearchServer(SearchServer&&) = default;
+    SearchServer& operator=(SearchServer&&) = default;
+
     void AddDocument(int document_id, std::string_view document_, DocumentStatus status,
         const std::vector<int>& ratings);
 
+    // Тексты пакета разбираются параллельно, затем индекс пополняется за один проход по всем словам пакета.
+    // Если хотя бы один документ некорректен, бросает std::invalid_argument и не меняет базу
+    void AddDocuments(const std::vector<DocumentInput>& documents);
+
+    // Разбирает пакет параллельно, не меняя сервер: может выполняться одновременно с добавлением другого пакета.
+    // Тексты должны оставаться доступными, пока результат не будет передан в AddDocuments
+    std::vector<PreparedDocument> PrepareDocuments(const std::vector<DocumentInput>& documents) const;
+
+    void AddDocuments(std::vector<PreparedDocument>&& documents);
+
+    // top_k - сколько лучших документов вернуть (по умолчанию MAX_RESULT_DOCUMENT_COUNT)
     template <typename Predicate>
     std::vector<Document> FindTopDocuments(std::string_view raw_query,
-        Predicate predicate) const;
+        Predicate predicate, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+        size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <typename ExecutionPolicy, typename Predicate>
     std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
-        Predicate predicate) const;
+        Predicate predicate, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <typename ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+        size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Пакетный поиск: запросы разбираются вместе, IDF каждого слова пакета вычисляется один раз,
+    // затем запросы обрабатываются параллельно. Результат каждого запроса совпадает с FindTopDocuments(query, status, top_k)
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+        DocumentStatus status = DocumentStatus::ACTUAL, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Пакетный поиск с результатами в одном массиве: документы запроса i записываются прямо в
+    // documents[offsets[i], offsets[i + 1]) без отдельного вектора на запрос. Под каждый запрос сначала
+    // отводится min(top_k, GetDocumentCount()) мест, затем неполные результаты сдвигаются к началу
+    void FindTopDocumentsBatchJoined(const std::vector<std::string>& raw_queries, std::vector<Document>& documents,
+        std::vector<size_t>& offsets, DocumentStatus status = DocumentStatus::ACTUAL,
+        size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
     size_t GetDocumentCount() const;
 
+    void SetRetrievalMode(RetrievalMode mode);
+
+    RetrievalMode GetRetrievalMode() const;
+
+    // Включает кэш результатов FindTopDocuments со статусом документа на capacity запросов.
+    // Запросы с произвольным предикатом не кэшируются; любое изменение базы делает сохранённые результаты устаревшими
+    void EnableQueryCache(size_t capacity);
+
+    void DisableQueryCache();
+
+    // nullptr, если кэш выключен
+    const QueryCache* GetQueryCache() const;
+
+    // Найденные слова ссылаются на словарь сервера и действительны, пока сервер существует и не вызван CompactTerms,
+    // в том числе после удаления документов с этими словами
     MatchedDocument MatchDocument(std::string_view raw_query,
         int document_id) const;
 
@@ -66,29 +152,78 @@ public:
 
     std::set<int>::const_iterator end() const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Слова ссылаются на словарь сервера, как в MatchDocument
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    // Отсортированные по возрастанию id слов документа без повторов; пустой список для неизвестного документа.
+    // Id слова постоянен, пока слово есть хотя бы в одном документе, поэтому наборы слов документов можно
+    // сравнивать по id, не обращаясь к тексту слов
+    std::vector<uint32_t> GetTermIds(int document_id) const;
 
     void RemoveDocument(int document_id);
 
     void RemoveDocument(Sequenced, int document_id);
 
     void RemoveDocument(Parallel, int document_id);
+
+    // Удаляет пакет документов: каждый затронутый список вхождений перекодируется один раз, списки обрабатываются
+    // параллельно. Неизвестные id пропускаются
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    // Возвращает память текстов слов, исчезнувших из базы, когда её больше, чем занимают слова базы.
+    // Слова при этом переносятся, и все string_view из MatchDocument и GetWordFrequencies становятся недействительными:
+    // вызывать, только когда такие ссылки не хранятся. Возвращает true, если слова были перенесены
+    bool CompactTerms();
+
+    // Сохраняет словарь, списки вхождений, данные документов и стоп-слова в двоичный снимок с контрольной суммой
+    void SaveSnapshot(const std::string& path) const;
+
+    // Отображает снимок в память: списки вхождений и данные документов читаются прямо из файла
+    // и копируются только при изменении. Бросает std::invalid_argument для повреждённого или несовместимого снимка
+    static SearchServer LoadSnapshot(const std::string& path);
+
+    // Независимая копия базы с собственным словарём: документы добавляются в новый сервер заново,
+    // поэтому номера ячеек и id слов могут отличаться, но результаты поиска совпадают.
+    // Копируются также режим поиска и ёмкость кэша запросов; сохранённые в кэше результаты не копируются
+    SearchServer Clone() const;
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
-        std::map<std::string_view, double> word_frequencies; //словарь слово из документа -> частота появления этого слова в этом документе
+    // Term frequency слова в документе хранится как число вхождений: count * slot_inv_word_counts_[slot]
+    struct TermFrequency {
+        uint32_t term_id;
+        uint32_t count;
     };
 
-    std::map<std::string_view, std::map<int, double>> documents_freqs_; //словарь слово -> (словарь id документа -> Term frequency слова в этом документе)
+    static constexpr int FREE_SLOT = -1;
+
+    std::shared_ptr<const MappedFile> snapshot_; //загруженный снимок; объявлен первым, чтобы освобождаться последним
+    TermDictionary terms_; //словарь слово <-> id слова
+    std::vector<PostingList> documents_freqs_; //id слова -> (отсортированный по номеру документа сжатый список вхождений слова в документы)
+    IdfCache idfs_; //id слова -> IDF, пересчитывается при первом запросе после изменения индекса
     std::set<std::string, std::less<>> stop_words_; 
-    std::map<int, DocumentData> documents_; //словарь номер документа -> информация о документе
+    StopWordSet stop_word_set_; //те же стоп-слова в виде таблицы для быстрой проверки слов документов и запросов
+    // Документы хранятся в плотно пронумерованных ячейках (slot); данные документа разложены по массивам, индексируемым номером ячейки
+    std::unordered_map<int, uint32_t> document_slots_; //id документа -> номер ячейки
+    std::vector<int> slot_document_ids_; //номер ячейки -> id документа (FREE_SLOT для свободной ячейки)
+    std::vector<int> slot_ratings_;
+    std::vector<DocumentStatus> slot_statuses_;
+    std::array<SlotBitmap, DOCUMENT_STATUS_COUNT> status_slots_; //статус -> ячейки документов с этим статусом
+    std::vector<FlatArray<TermFrequency>> slot_word_frequencies_; //отсортированный по id слова список: слово из документа -> число его вхождений в документ
+    std::vector<double> slot_inv_word_counts_; //1 / число слов документа без стоп-слов
+    std::vector<uint32_t> free_slots_;
     std::set<int> documents_ids_;
-    std::deque<std::string> storage;
+    RetrievalMode retrieval_mode_ = RetrievalMode::EXHAUSTIVE;
+    uint64_t generation_ = 0; //поколение индекса, увеличивается при каждом добавлении и удалении документов
+    std::unique_ptr<QueryCache> query_cache_;
 
     struct QueryContent {
-        std::vector<std::string_view> plus_words_;
-        std::vector<std::string_view> minus_words_;
+        std::vector<uint32_t> plus_words_; //id слов; слова, которых нет в словаре, в запрос не попадают
+        std::vector<uint32_t> minus_words_;
+    };
+
+    // Разобранный запрос пакета с IDF его плюс-слов
+    struct BatchQuery {
+        QueryContent query;
+        std::vector<double> idfs;
     };
 
     struct QueryWordContent {
@@ -97,6 +232,8 @@ private:
         bool IsStop;
     };
 
+    SearchServer() = default;
+
     template <typename StringContainer>
     std::set<std::string, std::less<>> SplitInputStringsContainerIntoStrings(const StringContainer& input_strings);
 
@@ -106,21 +243,133 @@ private:
 
     QueryWordContent IsMinusWord(std::string_view word) const;
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string& text) const;
+    // Не меняет сервер и может выполняться параллельно для разных документов
+    PreparedDocument PrepareDocument(int document_id, std::string_view document_, DocumentStatus status,
+        const std::vector<int>& ratings) const;
+
+    // Проверяет id всего пакета, затем добавляет документы в словарь, ячейки и списки вхождений
+    template <typename ExecutionPolicy>
+    void CommitDocuments(ExecutionPolicy&& policy, std::vector<PreparedDocument>& documents);
+
+    void ReleaseUnusedTerms(const FlatArray<TermFrequency>& word_frequencies);
+
+    uint32_t AllocateSlot(int document_id);
+
+    void FreeSlot(uint32_t slot);
+
+    void SetSlotStatus(uint32_t slot, DocumentStatus status);
+
+    double GetTermFreq(uint32_t slot, uint32_t count) const;
 
     QueryContent ParseQuery(std::string_view text, bool if_par = false) const;
 
-    double ComputeIdf(std::string_view word) const;
+    // Ячейки документов с минус-словами запроса. Если вхождений минус-слов меньше, чем 64-битных слов
+    // в битовой карте всех ячеек, хранится их отсортированный список: обнулять карту ради нескольких
+    // документов дольше, чем искать номер в коротком списке
+    class ExcludedSlots {
+    public:
+        ExcludedSlots() = default;
+
+        explicit ExcludedSlots(SlotBitmap bitmap);
+
+        // slots отсортированы и не повторяются
+        explicit ExcludedSlots(std::vector<uint32_t> slots);
+
+        bool Test(uint32_t slot) const {
+            if (is_sparse_) {
+                return std::binary_search(slots_.begin(), slots_.end(), slot);
+            }
+            return bitmap_.Test(slot);
+        }
+    private:
+        bool is_sparse_ = true;
+        std::vector<uint32_t> slots_;
+        SlotBitmap bitmap_;
+    };
+
+    // Документы, содержащие минус-слова запроса: находятся до подсчёта релевантности,
+    // чтобы вклад плюс-слов в исключённые документы не вычислялся вовсе
+    ExcludedSlots GetExcludedSlots(const QueryContent& query) const;
+
+    double ComputeIdf(uint32_t term_id) const;
+
+    // IDF плюс-слов запроса в порядке query.plus_words_
+    std::vector<double> ComputeIdfs(const QueryContent& query) const;
+
+    // Разбирает запросы пакета параллельно и вычисляет IDF каждого слова пакета один раз
+    std::vector<BatchQuery> PrepareBatchQueries(const std::vector<std::string>& raw_queries) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
-    template <typename Predicate>
-    std::vector<Document> FindAllDocuments(Sequenced, const QueryContent& query, Predicate predicate) const;
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+    // Отбирает top_k самых релевантных из добавленных документов, храня не больше top_k документов.
+    // Из документов, равных по IsMoreRelevant, остаются документы с меньшим id, поэтому результат
+    // не зависит от порядка добавления
+    class TopDocumentsCollector {
+    public:
+        explicit TopDocumentsCollector(size_t top_k);
+
+        void Add(const Document& document);
+
+        bool IsFull() const;
+
+        size_t GetTopK() const;
+
+        // Наименее релевантный из отобранных документов; набор не должен быть пуст
+        const Document& GetWorst() const;
+
+        // Отобранные документы в порядке убывания релевантности; равные упорядочены по id
+        std::vector<Document> Extract();
+
+        // То же, но документы переносятся в output, где должно быть место под top_k документов; возвращает их число
+        size_t ExtractTo(Document* output);
+
+        // Заменяет набор готовым результатом не больше чем из top_k документов, например из кэша
+        void Assign(std::vector<Document> documents);
+    private:
+        size_t top_k_;
+        std::vector<Document> heap_; //на вершине наименее релевантный документ
+
+        // IsMoreRelevant, дополненный сравнением id: равные по релевантности и рейтингу документы тоже упорядочены
+        static bool IsBetter(const Document& lhs, const Document& rhs);
+    };
+
+    // Поиск принимает фильтр по номеру ячейки документа: filter(slot) == true, если документ подходит.
+    // Фильтр по статусу - проверка бита, произвольный предикат оборачивается в MakeSlotFilter.
+    // Релевантность вычисляется для всех подходящих документов, но хранятся только top_k лучших.
+    // Найденные документы добавляются в top_documents, откуда их забирает вызывающий
+    template <typename SlotFilter>
+    void FindTopDocumentsExhaustive(Sequenced, const QueryContent& query, const std::vector<double>& idfs,
+        SlotFilter filter, TopDocumentsCollector& top_documents) const;
+
+    template <typename SlotFilter>
+    void FindTopDocumentsExhaustive(Parallel, const QueryContent& query, const std::vector<double>& idfs,
+        SlotFilter filter, TopDocumentsCollector& top_documents) const;
+
+    // Суммирует релевантность документов из ячеек [block_begin, block_end) в плотном массиве потока
+    // и добавляет их в top_documents; возвращает число найденных документов
+    template <typename SlotFilter>
+    size_t ScoreSlotBlock(const QueryContent& query, const std::vector<double>& idfs, SlotFilter filter,
+        const ExcludedSlots& excluded, uint32_t block_begin, uint32_t block_end, TopDocumentsCollector& top_documents) const;
+
+    template <typename ExecutionPolicy, typename SlotFilter>
+    void FindTopDocumentsForQuery(ExecutionPolicy&& policy, const QueryContent& query,
+        const std::vector<double>& idfs, SlotFilter filter, TopDocumentsCollector& top_documents) const;
+
+    // Поиск со статусом документа через кэш результатов, если он включён
+    template <typename ExecutionPolicy>
+    void FindTopDocumentsWithStatus(ExecutionPolicy&& policy, const QueryContent& query,
+        const std::vector<double>& idfs, DocumentStatus status, TopDocumentsCollector& top_documents) const;
+
+    template <typename SlotFilter>
+    void FindTopDocumentsMaxScore(const QueryContent& query, const std::vector<double>& idfs,
+        SlotFilter filter, TopDocumentsCollector& top_documents) const;
 
     template <typename Predicate>
-    std::vector<Document> FindAllDocuments(Parallel, const QueryContent& query, Predicate predicate) const;
+    auto MakeSlotFilter(const Predicate& predicate) const;
 
-    void RemoveDuplicatesWords(std::vector<std::string_view>& words) const;
+    void RemoveDuplicatesWords(std::vector<uint32_t>& words) const;
 };
 
 template <typename StringContainer>
@@ -130,100 +379,370 @@ SearchServer::SearchServer(const StringContainer& text) : stop_words_(SplitInput
             throw std::invalid_argument("This stop-word contains invalid characters"s);
         }
     }
+    stop_word_set_ = StopWordSet(stop_words_);
 }
 
 template <typename Predicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
-    Predicate predicate) const {
-    return FindTopDocuments(std::execution::seq, raw_query, predicate);
+    Predicate predicate, size_t top_k) const {
+    return FindTopDocuments(std::execution::seq, raw_query, predicate, top_k);
 }
 
 template <typename ExecutionPolicy, typename Predicate>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query,
-    Predicate predicate) const {
+    Predicate predicate, size_t top_k) const {
         const QueryContent query = ParseQuery(raw_query);
-        std::vector<Document> matched_documents;
-        matched_documents.reserve(storage.size());
-        matched_documents = FindAllDocuments(policy, query, predicate);        
-        sort(policy, matched_documents.begin(), matched_documents.end(),
-            [predicate](const Document& lhs, const Document& rhs) {
-                if (std::abs(lhs.relevance - rhs.relevance) < ALLOWABLE_ERROR) {
-                    return lhs.rating > rhs.rating;
-                }
-                else {
-                    return lhs.relevance > rhs.relevance;
-                }
-            }); 
-        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-        }
-        return matched_documents;
+        TopDocumentsCollector top_documents(top_k);
+        FindTopDocumentsForQuery(policy, query, ComputeIdfs(query), MakeSlotFilter(predicate), top_documents);
+        return top_documents.Extract();
+}
+
+template <typename Predicate>
+auto SearchServer::MakeSlotFilter(const Predicate& predicate) const {
+    return [this, &predicate](const uint32_t slot) {
+        return predicate(slot_document_ids_[slot], slot_statuses_[slot], slot_ratings_[slot]);
+    };
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status,
+    size_t top_k) const {
+        const QueryContent query = ParseQuery(raw_query);
+        TopDocumentsCollector top_documents(top_k);
+        FindTopDocumentsWithStatus(policy, query, ComputeIdfs(query), status, top_documents);
+        return top_documents.Extract();
 }
 
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const {
-        return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus status_, int rating) {
-            return status_ == status; });
+void SearchServer::FindTopDocumentsWithStatus(ExecutionPolicy&& policy, const QueryContent& query,
+    const std::vector<double>& idfs, DocumentStatus status, TopDocumentsCollector& top_documents) const {
+        if (static_cast<size_t>(status) >= DOCUMENT_STATUS_COUNT) {
+            return;
+        }
+        // Документы с нужным статусом отмечены в битовой карте, поэтому проверка не читает данные документа
+        const SlotBitmap& status_slots = status_slots_[static_cast<size_t>(status)];
+        const auto filter = [&status_slots](const uint32_t slot) { return status_slots.Test(slot); };
+        if (!query_cache_) {
+            FindTopDocumentsForQuery(policy, query, idfs, filter, top_documents);
+            return;
+        }
+        // ParseQuery уже отсортировал слова и убрал повторы, поэтому одинаковые по смыслу запросы дают один ключ
+        QueryCache::Key key{ query.plus_words_, query.minus_words_, static_cast<uint64_t>(status), top_documents.GetTopK() };
+        if (auto cached = query_cache_->Find(key, generation_)) {
+            top_documents.Assign(std::move(*cached));
+            return;
+        }
+        FindTopDocumentsForQuery(policy, query, idfs, filter, top_documents);
+        std::vector<Document> result = top_documents.Extract();
+        query_cache_->Insert(std::move(key), generation_, result);
+        top_documents.Assign(std::move(result));
 }
 
-template < typename Predicate>
-std::vector<Document> SearchServer::FindAllDocuments(Sequenced, const QueryContent& query, Predicate predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (std::string_view word : query.plus_words_) {
-        if (documents_freqs_.count(word) != 0) {
-            const double inverse_document_frequency = ComputeIdf(word);
-            for (const auto [document_id, term_freq] : documents_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
-                if (predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id] += term_freq * inverse_document_frequency;
-                }
+template <typename ExecutionPolicy, typename SlotFilter>
+void SearchServer::FindTopDocumentsForQuery(ExecutionPolicy&& policy, const QueryContent& query,
+    const std::vector<double>& idfs, SlotFilter filter, TopDocumentsCollector& top_documents) const {
+        if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, Sequenced>) {
+            if (retrieval_mode_ == RetrievalMode::MAX_SCORE) {
+                FindTopDocumentsMaxScore(query, idfs, filter, top_documents);
+                return;
             }
         }
+        FindTopDocumentsExhaustive(policy, query, idfs, filter, top_documents);
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::CommitDocuments(ExecutionPolicy&& policy, std::vector<PreparedDocument>& documents) {
+    // Весь пакет проверяется до первого изменения базы
+    std::unordered_set<int> batch_ids;
+    size_t posting_count = 0;
+    for (const PreparedDocument& document : documents) {
+        if (!document.is_valid || document.id < 0 || document_slots_.count(document.id) != 0
+            || static_cast<size_t>(document.status) >= DOCUMENT_STATUS_COUNT
+            || !batch_ids.insert(document.id).second) {
+            throw std::invalid_argument("Invalid document data"s);
+        }
+        posting_count += document.word_counts.size();
     }
-    for (std::string_view word : query.minus_words_) {
-        if (documents_freqs_.count(word) != 0) {
-            for (const auto [document_id, _] : documents_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
-            }
+    STAGE_COUNTER_ADD("search_server.documents_added", documents.size());
+    STAGE_COUNTER_ADD("search_server.postings_added", posting_count);
+    ++generation_;
+
+    // Словарь пополняется последовательно; у каждого документа получается отсортированный по id слова список частот
+    std::vector<uint32_t> slots;
+    slots.reserve(documents.size());
+    for (const PreparedDocument& document : documents) {
+        const uint32_t slot = AllocateSlot(document.id);
+        auto& word_frequencies = slot_word_frequencies_[slot].Mutable();
+        word_frequencies.reserve(document.word_counts.size());
+        for (const auto& [word, count] : document.word_counts) {
+            word_frequencies.push_back({ terms_.Intern(word), count });
+        }
+        slot_inv_word_counts_[slot] = document.inv_word_count;
+        slot_ratings_[slot] = document.rating;
+        SetSlotStatus(slot, document.status);
+        documents_ids_.emplace(document.id);
+        slots.push_back(slot);
+    }
+    std::for_each(policy, slots.begin(), slots.end(), [this](const uint32_t slot) {
+        auto& word_frequencies = slot_word_frequencies_[slot].Mutable();
+        std::sort(word_frequencies.begin(), word_frequencies.end(),
+            [](const TermFrequency& lhs, const TermFrequency& rhs) { return lhs.term_id < rhs.term_id; });
+        });
+    if (documents_freqs_.size() < terms_.size()) {
+        documents_freqs_.resize(terms_.size());
+        idfs_.Resize(terms_.size());
+    }
+    if (slots.size() == 1) {
+        for (const auto [term_id, count] : slot_word_frequencies_[slots.front()]) {
+            const Posting posting{ slots.front(), count };
+            documents_freqs_[term_id].Merge(&posting, &posting + 1, GetTermFreq(slots.front(), count));
         }
+        return;
     }
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back(
-            { document_id, relevance, documents_.at(document_id).rating });
+
+    // Новые вхождения раскладываются по словам сортировкой подсчётом, после чего
+    // каждый список вхождений пополняется одним слиянием независимо от остальных
+    std::vector<size_t> term_begins(documents_freqs_.size() + 1, 0);
+    for (const uint32_t slot : slots) {
+        for (const auto [term_id, _] : slot_word_frequencies_[slot]) {
+            ++term_begins[term_id + 1];
+        }
     }
-    return matched_documents;
+    std::partial_sum(term_begins.begin(), term_begins.end(), term_begins.begin());
+    std::vector<Posting> new_postings(posting_count);
+    std::vector<size_t> positions(term_begins.begin(), std::prev(term_begins.end()));
+    std::vector<uint32_t> new_terms;
+    for (const uint32_t slot : slots) {
+        for (const auto [term_id, count] : slot_word_frequencies_[slot]) {
+            if (positions[term_id] == term_begins[term_id]) {
+                new_terms.push_back(term_id);
+            }
+            new_postings[positions[term_id]++] = { slot, count };
+        }
+    }
+    std::for_each(policy, new_terms.begin(), new_terms.end(), [&](const uint32_t term_id) {
+        // Освободившиеся ячейки переиспользуются, поэтому номера документов пакета могут идти не по порядку
+        Posting* const first = new_postings.data() + term_begins[term_id];
+        Posting* const last = new_postings.data() + term_begins[term_id + 1];
+        if (!std::is_sorted(first, last, [](const Posting& lhs, const Posting& rhs) { return lhs.slot < rhs.slot; })) {
+            std::sort(first, last, [](const Posting& lhs, const Posting& rhs) { return lhs.slot < rhs.slot; });
+        }
+        double max_term_freq = 0.0;
+        for (const Posting* posting = first; posting != last; ++posting) {
+            max_term_freq = std::max(max_term_freq, GetTermFreq(posting->slot, posting->count));
+        }
+        documents_freqs_[term_id].Merge(first, last, max_term_freq);
+        });
 }
 
-template <typename Predicate>
-std::vector<Document> SearchServer::FindAllDocuments(Parallel, const QueryContent& query, Predicate predicate) const {
-        ConcurrentMap<int, double> doc_to_relev_concur(1000);
-        std::for_each(std::execution::par, query.plus_words_.begin(), query.plus_words_.end(), [&](std::string_view word) {
-            if (documents_freqs_.count(word) != 0) {
-                const double inverse_document_frequency = ComputeIdf(word);
-                std::for_each(std::execution::par, documents_freqs_.at(word).begin(), documents_freqs_.at(word).end(), [&](const std::pair<int, double>& element) {
-                    const auto& document_data = documents_.at(element.first);
-                    if (predicate(element.first, document_data.status, document_data.rating)) {
-                        doc_to_relev_concur[element.first].ref_to_value += element.second * inverse_document_frequency;
-                    }
-                    });
+template <typename SlotFilter>
+size_t SearchServer::ScoreSlotBlock(const QueryContent& query, const std::vector<double>& idfs, SlotFilter filter,
+    const ExcludedSlots& excluded, uint32_t block_begin, uint32_t block_end, TopDocumentsCollector& top_documents) const {
+    // Массивы потока переиспользуются между блоками и запросами; после блока очищаются только затронутые ячейки
+    thread_local std::vector<double> relevance;
+    thread_local std::vector<char> found;
+    thread_local std::vector<uint32_t> touched;
+    const uint32_t block_span = block_end - block_begin;
+    if (relevance.size() < block_span) {
+        relevance.assign(block_span, 0.0);
+        found.assign(block_span, 0);
+    }
+    touched.clear();
+    const bool has_excluded = !query.minus_words_.empty();
+    for (size_t i = 0; i < query.plus_words_.size(); ++i) {
+        const double idf = idfs[i];
+        documents_freqs_[query.plus_words_[i]].ForEach(block_begin, block_end,
+            [&](const uint32_t slot, const uint32_t count) {
+            if (has_excluded && excluded.Test(slot)) {
+                return;
             }
-            });
-        for (std::string_view word : query.minus_words_) {
-            if (documents_freqs_.count(word) != 0) {
-                for (const auto [document_id, _] : documents_freqs_.at(word)) {
-                    doc_to_relev_concur.erase(document_id);
+            if (filter(slot)) {
+                const uint32_t offset = slot - block_begin;
+                if (found[offset] == 0) {
+                    found[offset] = 1;
+                    touched.push_back(offset);
                 }
+                relevance[offset] += GetTermFreq(slot, count) * idf;
+            }
+            });
+    }
+    if (touched.empty()) {
+        return 0;
+    }
+    STAGE_TIMER("search_server.select_top_documents.drain");
+    for (const uint32_t offset : touched) {
+        const uint32_t slot = block_begin + offset;
+        top_documents.Add({ slot_document_ids_[slot], relevance[offset], slot_ratings_[slot] });
+        relevance[offset] = 0.0;
+        found[offset] = 0;
+    }
+    return touched.size();
+}
+
+template <typename SlotFilter>
+void SearchServer::FindTopDocumentsExhaustive(Sequenced, const QueryContent& query,
+    const std::vector<double>& idfs, SlotFilter filter, TopDocumentsCollector& top_documents) const {
+    STAGE_TIMER("search_server.find_top_documents.exhaustive.seq");
+    if (document_slots_.empty() || query.plus_words_.empty() || top_documents.GetTopK() == 0) {
+        return;
+    }
+    // Блоки обходятся по очереди, поэтому плотный массив релевантностей не больше одного блока
+    const ExcludedSlots excluded = GetExcludedSlots(query);
+    const uint32_t slot_count = static_cast<uint32_t>(slot_document_ids_.size());
+    size_t matched_documents = 0;
+    for (uint32_t block_begin = 0; block_begin < slot_count; block_begin += MAX_PARALLEL_BLOCK_SPAN) {
+        const uint32_t block_end = std::min<uint32_t>(block_begin + MAX_PARALLEL_BLOCK_SPAN, slot_count);
+        matched_documents += ScoreSlotBlock(query, idfs, filter, excluded, block_begin, block_end, top_documents);
+    }
+    STAGE_COUNTER_ADD("search_server.matched_documents", matched_documents);
+}
+
+template <typename SlotFilter>
+void SearchServer::FindTopDocumentsExhaustive(Parallel, const QueryContent& query,
+    const std::vector<double>& idfs, SlotFilter filter, TopDocumentsCollector& top_documents) const {
+    STAGE_TIMER("search_server.find_top_documents.exhaustive.par");
+    const size_t top_k = top_documents.GetTopK();
+    if (document_slots_.empty() || query.plus_words_.empty() || top_k == 0) {
+        return;
+    }
+
+    // Диапазон номеров документов делится на непересекающиеся блоки. Каждый блок обрабатывается одним потоком
+    // в собственном плотном массиве релевантностей, поэтому блокировки не нужны; от блока остаются только его top_k лучших
+    const ExcludedSlots excluded = GetExcludedSlots(query);
+    const uint32_t slot_count = static_cast<uint32_t>(slot_document_ids_.size());
+    const uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+    const uint32_t block_span = std::clamp<uint32_t>(slot_count / (threads * 4), 1024, MAX_PARALLEL_BLOCK_SPAN);
+    std::vector<std::vector<Document>> block_documents((slot_count + block_span - 1) / block_span);
+    std::vector<size_t> blocks(block_documents.size());
+    std::iota(blocks.begin(), blocks.end(), 0);
+
+    std::for_each(std::execution::par, blocks.begin(), blocks.end(), [&](const size_t block) {
+        const uint32_t block_begin = static_cast<uint32_t>(block) * block_span;
+        const uint32_t block_end = std::min(block_begin + block_span, slot_count);
+        TopDocumentsCollector block_top_documents(top_k);
+        const size_t matched_documents = ScoreSlotBlock(query, idfs, filter, excluded, block_begin, block_end,
+            block_top_documents);
+        if (matched_documents != 0) {
+            STAGE_COUNTER_ADD("search_server.matched_documents", matched_documents);
+            block_documents[block] = block_top_documents.Extract();
+        }
+        });
+
+    // Отбор не зависит от порядка документов, поэтому результат совпадает с последовательным поиском
+    STAGE_TIMER("search_server.select_top_documents.drain");
+    for (const std::vector<Document>& documents : block_documents) {
+        for (const Document& document : documents) {
+            top_documents.Add(document);
+        }
+    }
+}
+
+template <typename SlotFilter>
+void SearchServer::FindTopDocumentsMaxScore(const QueryContent& query, const std::vector<double>& idfs,
+    SlotFilter filter, TopDocumentsCollector& top_documents) const {
+    STAGE_TIMER("search_server.find_top_documents.max_score");
+    if (top_documents.GetTopK() == 0) {
+        return;
+    }
+    struct TermCursor {
+        PostingList::Cursor it;
+        size_t query_index; // позиция слова в запросе: релевантность суммируется в том же порядке, что и в FindTopDocumentsExhaustive
+        double idf;
+        double upper_bound;
+    };
+    std::vector<TermCursor> cursors;
+    for (size_t i = 0; i < query.plus_words_.size(); ++i) {
+        const PostingList& postings = documents_freqs_[query.plus_words_[i]];
+        if (!postings.empty()) {
+            cursors.push_back({ postings.GetCursor(), i, idfs[i], postings.GetMaxTermFreq() * idfs[i] });
+        }
+    }
+    std::sort(cursors.begin(), cursors.end(), [](const TermCursor& lhs, const TermCursor& rhs) {
+        return lhs.upper_bound < rhs.upper_bound; });
+    // bound_prefix[i] - максимально возможный суммарный вклад слов cursors[0..i)
+    std::vector<double> bound_prefix(cursors.size() + 1, 0.0);
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        bound_prefix[i + 1] = bound_prefix[i] + cursors[i].upper_bound;
+    }
+    std::vector<TermCursor> minus_cursors;
+    for (const uint32_t term_id : query.minus_words_) {
+        minus_cursors.push_back({ documents_freqs_[term_id].GetCursor(), 0, 0.0, 0.0 });
+    }
+
+    // Документ может попасть в результат, только если его релевантность не меньше threshold - ALLOWABLE_ERROR;
+    // небольшой запас компенсирует ошибки округления при суммировании границ в другом порядке
+    const auto can_compete = [](double bound, double threshold) {
+        return bound + bound * 1e-12 >= threshold - ALLOWABLE_ERROR;
+    };
+    double threshold = 0.0;
+    // Слова cursors[0..first_essential) сами по себе не могут поднять документ выше порога,
+    // поэтому кандидаты выбираются только по спискам остальных слов
+    size_t first_essential = 0;
+    std::vector<double> contributions(query.plus_words_.size());
+
+    while (first_essential < cursors.size()) {
+        uint32_t slot = UINT32_MAX;
+        for (size_t i = first_essential; i < cursors.size(); ++i) {
+            if (!cursors[i].it.IsEnd()) {
+                slot = std::min(slot, cursors[i].it.GetSlot());
+            }
+        }
+        if (slot == UINT32_MAX) {
+            break;
+        }
+        std::fill(contributions.begin(), contributions.end(), 0.0);
+        double score = 0.0;
+        for (size_t i = first_essential; i < cursors.size(); ++i) {
+            TermCursor& cursor = cursors[i];
+            if (!cursor.it.IsEnd() && cursor.it.GetSlot() == slot) {
+                contributions[cursor.query_index] = GetTermFreq(slot, cursor.it.GetCount()) * cursor.idf;
+                score += contributions[cursor.query_index];
+                cursor.it.Next();
+            }
+        }
+        if (!filter(slot)) {
+            continue;
+        }
+        bool pruned = false;
+        for (size_t i = first_essential; i-- > 0;) {
+            if (top_documents.IsFull() && !can_compete(score + bound_prefix[i + 1], threshold)) {
+                pruned = true;
+                break;
+            }
+            TermCursor& cursor = cursors[i];
+            cursor.it.Seek(slot);
+            if (!cursor.it.IsEnd() && cursor.it.GetSlot() == slot) {
+                contributions[cursor.query_index] = GetTermFreq(slot, cursor.it.GetCount()) * cursor.idf;
+                score += contributions[cursor.query_index];
+            }
+        }
+        if (pruned || (top_documents.IsFull() && !can_compete(score, threshold))) {
+            continue;
+        }
+        bool excluded = false;
+        for (TermCursor& cursor : minus_cursors) {
+            cursor.it.Seek(slot);
+            if (!cursor.it.IsEnd() && cursor.it.GetSlot() == slot) {
+                excluded = true;
+                break;
             }
         }
-        std::vector<Document> matched_documents;
-        std::map<int, double> document_to_relevance = doc_to_relev_concur.BuildOrdinaryMap();
-        matched_documents.reserve(document_to_relevance.size());
-        for (const auto [document_id, relevance] : document_to_relevance) {
-            matched_documents.push_back(
-                { document_id, relevance, documents_.at(document_id).rating });
+        if (excluded) {
+            continue;
         }
-        return matched_documents;
+        double relevance = 0.0;
+        for (const double contribution : contributions) {
+            relevance += contribution;
+        }
+        const Document document(slot_document_ids_[slot], relevance, slot_ratings_[slot]);
+        top_documents.Add(document);
+        if (top_documents.IsFull()) {
+            threshold = top_documents.GetWorst().relevance;
+            while (first_essential < cursors.size() && !can_compete(bound_prefix[first_essential + 1], threshold)) {
+                ++first_essential;
+            }
+        }
+    }
 }
 
 template <typename StringContainer>
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Битовая карта над номерами ячеек документов SearchServer: один бит на ячейку
+class SlotBitmap {
+public:
+    SlotBitmap() = default;
+
+    explicit SlotBitmap(size_t size) : words_((size + 63) / 64, 0), size_(size) {
+    }
+
+    void Set(uint32_t slot) {
+        words_[slot / 64] |= uint64_t{ 1 } << (slot % 64);
+    }
+
+    void Reset(uint32_t slot) {
+        words_[slot / 64] &= ~(uint64_t{ 1 } << (slot % 64));
+    }
+
+    bool Test(uint32_t slot) const {
+        return (words_[slot / 64] >> (slot % 64)) & 1;
+    }
+
+    // Новые ячейки не отмечены
+    void Resize(size_t size) {
+        words_.resize((size + 63) / 64, 0);
+        size_ = size;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+private:
+    std::vector<uint64_t> words_;
+    size_t size_ = 0;
+};
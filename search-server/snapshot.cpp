@@ -0,0 +1,213 @@
+#include "snapshot.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::literals::string_literals::operator""s;
+
+namespace {
+const char SNAPSHOT_MAGIC[8] = { 'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P' };
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+}
+
+void SnapshotChecksum::Update(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    total_size_ += size;
+    while (size > 0 && pending_size_ != 0) {
+        pending_ |= static_cast<uint64_t>(static_cast<unsigned char>(*bytes)) << (8 * pending_size_);
+        ++bytes;
+        --size;
+        if (++pending_size_ == sizeof(uint64_t)) {
+            Mix(pending_);
+            pending_ = 0;
+            pending_size_ = 0;
+        }
+    }
+    for (; size >= sizeof(uint64_t); bytes += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        Mix(word);
+    }
+    for (; size > 0; ++bytes, --size) {
+        pending_ |= static_cast<uint64_t>(static_cast<unsigned char>(*bytes)) << (8 * pending_size_);
+        ++pending_size_;
+    }
+}
+
+uint64_t SnapshotChecksum::Finish() const {
+    uint64_t hash = hash_;
+    hash ^= pending_ + total_size_;
+    hash *= 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+void SnapshotChecksum::Mix(uint64_t word) {
+    hash_ ^= word;
+    hash_ *= 0x100000001b3ull;
+    hash_ ^= hash_ >> 31;
+}
+
+MappedFile::MappedFile(const std::string& path) {
+#ifndef _WIN32
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file "s + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error("Cannot read file "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map file "s + path);
+        }
+        data_ = static_cast<const char*>(mapped);
+    }
+    close(fd);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open file "s + path);
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+const char* MappedFile::data() const {
+    return data_;
+}
+
+size_t MappedFile::size() const {
+    return size_;
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& path) :
+        path_(path),
+        temp_path_(path + ".tmp"s),
+        out_(temp_path_, std::ios::binary | std::ios::trunc) {
+    if (!out_) {
+        throw std::runtime_error("Cannot create snapshot "s + temp_path_);
+    }
+    const SnapshotHeader header{};
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (!finished_) {
+        out_.close();
+        std::remove(temp_path_.c_str());
+    }
+}
+
+void SnapshotWriter::Write(const void* data, size_t size) {
+    out_.write(static_cast<const char*>(data), size);
+    checksum_.Update(data, size);
+    payload_size_ += size;
+}
+
+void SnapshotWriter::Align() {
+    static const char zeros[8] = {};
+    if (payload_size_ % 8 != 0) {
+        Write(zeros, 8 - payload_size_ % 8);
+    }
+}
+
+void SnapshotWriter::Finish(uint32_t posting_size, uint32_t term_frequency_size) {
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.posting_size = posting_size;
+    header.term_frequency_size = term_frequency_size;
+    header.payload_size = payload_size_;
+    header.checksum = checksum_.Finish();
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.close();
+    if (!out_) {
+        throw std::runtime_error("Cannot write snapshot"s);
+    }
+#ifdef _WIN32
+    // std::rename не заменяет существующий файл
+    std::remove(path_.c_str());
+#endif
+    if (std::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+        throw std::runtime_error("Cannot replace snapshot "s + path_);
+    }
+    finished_ = true;
+}
+
+SnapshotReader::SnapshotReader(const MappedFile& file, uint32_t posting_size, uint32_t term_frequency_size) {
+    SnapshotHeader header;
+    if (file.size() < sizeof(header)) {
+        throw std::invalid_argument("Snapshot is truncated"s);
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        throw std::invalid_argument("File is not a search server snapshot"s);
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        throw std::invalid_argument("Unsupported snapshot version "s + std::to_string(header.version));
+    }
+    if (header.byte_order != BYTE_ORDER_MARK || header.posting_size != posting_size
+        || header.term_frequency_size != term_frequency_size) {
+        throw std::invalid_argument("Snapshot was written on an incompatible platform"s);
+    }
+    if (header.payload_size != file.size() - sizeof(header)) {
+        throw std::invalid_argument("Snapshot is truncated"s);
+    }
+    begin_ = position_ = file.data() + sizeof(header);
+    end_ = begin_ + header.payload_size;
+    SnapshotChecksum checksum;
+    checksum.Update(begin_, header.payload_size);
+    if (checksum.Finish() != header.checksum) {
+        throw std::invalid_argument("Snapshot checksum mismatch"s);
+    }
+}
+
+std::string_view SnapshotReader::ReadBytes(size_t size) {
+    return { Take(size), size };
+}
+
+void SnapshotReader::Align() {
+    const size_t offset = static_cast<size_t>(position_ - begin_);
+    if (offset % 8 != 0) {
+        Take(8 - offset % 8);
+    }
+}
+
+bool SnapshotReader::AtEnd() const {
+    return position_ == end_;
+}
+
+const char* SnapshotReader::Take(size_t size) {
+    if (static_cast<size_t>(end_ - position_) < size) {
+        throw std::invalid_argument("Snapshot is truncated"s);
+    }
+    const char* result = position_;
+    position_ += size;
+    return result;
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Вспомогательные классы двоичного снимка индекса SearchServer (см. SearchServer::SaveSnapshot).
+//
+// Формат: заголовок SnapshotHeader, затем данные, разбитые на секции, каждая из которых выровнена на 8 байт.
+// Массивы записываются в памятном представлении текущей платформы, поэтому после отображения файла
+// в память их можно читать напрямую, без разбора.
+
+const uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order; //0x01020304 в порядке байт платформы, записавшей снимок
+    uint32_t posting_size;
+    uint32_t term_frequency_size;
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+// 64-битная контрольная сумма, обрабатывающая данные словами по 8 байт
+class SnapshotChecksum {
+public:
+    void Update(const void* data, size_t size);
+
+    uint64_t Finish() const;
+private:
+    uint64_t hash_ = 0xcbf29ce484222325ull;
+    uint64_t pending_ = 0;
+    size_t pending_size_ = 0;
+    uint64_t total_size_ = 0;
+
+    void Mix(uint64_t word);
+};
+
+// Файл, отображённый в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    const char* data() const;
+
+    size_t size() const;
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<char> buffer_; //используется там, где нет mmap
+};
+
+// Снимок пишется во временный файл path + ".tmp" и заменяет path только в Finish, поэтому прерванная запись
+// не портит прежний снимок, а сервер, загруженный из path, может сохраниться в тот же файл
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path);
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // Удаляет временный файл, если запись не завершена
+    ~SnapshotWriter();
+
+    void Write(const void* data, size_t size);
+
+    template <typename T>
+    void WriteValue(const T& value) {
+        Write(&value, sizeof(T));
+    }
+
+    template <typename T>
+    void WriteArray(const T* data, size_t count) {
+        Write(data, sizeof(T) * count);
+    }
+
+    void Align();
+
+    // Дописывает заголовок с размером и контрольной суммой данных и переименовывает временный файл в path
+    void Finish(uint32_t posting_size, uint32_t term_frequency_size);
+private:
+    std::string path_;
+    std::string temp_path_;
+    bool finished_ = false;
+    std::ofstream out_;
+    SnapshotChecksum checksum_;
+    uint64_t payload_size_ = 0;
+};
+
+// Последовательное чтение секций снимка с проверкой границ
+class SnapshotReader {
+public:
+    SnapshotReader(const MappedFile& file, uint32_t posting_size, uint32_t term_frequency_size);
+
+    // Одиночные значения могут быть не выровнены (например, длины стоп-слов), поэтому копируются
+    template <typename T>
+    T ReadValue() {
+        T value;
+        std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    // Возвращает указатель прямо на данные снимка
+    template <typename T>
+    const T* ReadArray(size_t count) {
+        return reinterpret_cast<const T*>(Take(sizeof(T) * count));
+    }
+
+    std::string_view ReadBytes(size_t size);
+
+    void Align();
+
+    bool AtEnd() const;
+private:
+    const char* begin_;
+    const char* position_;
+    const char* end_;
+
+    const char* Take(size_t size);
+};
@@ -0,0 +1,207 @@
+#include "stage_metrics.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include "latency_buckets.h"
+
+using namespace std::literals;
+
+namespace {
+// Относительная погрешность 1/32
+using Buckets = LogLinearBuckets<5>;
+constexpr size_t BUCKET_COUNT = Buckets::COUNT;
+
+// Значение меняет только поток-владелец, поэтому достаточно обычных загрузки и сохранения:
+// атомарность нужна лишь для того, чтобы GetMetricsSnapshot мог читать его одновременно с записью
+void Increment(std::atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+struct HistogramData {
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+    std::atomic<uint64_t> count{ 0 };
+    std::atomic<uint64_t> sum{ 0 };
+    std::atomic<uint64_t> max{ 0 };
+};
+
+// Метрики одного потока. Гистограммы создаются при первой записи, чтобы поток не занимал память под все сразу
+struct ThreadMetrics {
+    std::array<std::atomic<uint64_t>, MAX_METRICS> counters{};
+    std::array<std::atomic<HistogramData*>, MAX_METRICS> histograms{};
+
+    ~ThreadMetrics() {
+        for (const auto& histogram : histograms) {
+            delete histogram.load(std::memory_order_relaxed);
+        }
+    }
+};
+
+class MetricsRegistry {
+public:
+    static MetricsRegistry& GetInstance() {
+        static MetricsRegistry registry;
+        return registry;
+    }
+
+    size_t RegisterCounter(std::string_view name) {
+        return Register(counter_names_, name);
+    }
+
+    size_t RegisterHistogram(std::string_view name) {
+        return Register(histogram_names_, name);
+    }
+
+    // Метрики завершившегося потока достаются следующему новому потоку и продолжают накапливаться
+    ThreadMetrics* AcquireThreadMetrics() {
+        std::lock_guard guard(mutex_);
+        if (!free_threads_.empty()) {
+            ThreadMetrics* const metrics = free_threads_.back();
+            free_threads_.pop_back();
+            return metrics;
+        }
+        threads_.push_back(std::make_unique<ThreadMetrics>());
+        return threads_.back().get();
+    }
+
+    void ReleaseThreadMetrics(ThreadMetrics* metrics) {
+        std::lock_guard guard(mutex_);
+        free_threads_.push_back(metrics);
+    }
+
+    MetricsSnapshot GetSnapshot() {
+        std::lock_guard guard(mutex_);
+        MetricsSnapshot snapshot;
+        for (size_t counter = 0; counter < counter_names_.size(); ++counter) {
+            CounterSnapshot& result = snapshot.counters.emplace_back();
+            result.name = counter_names_[counter];
+            for (const auto& metrics : threads_) {
+                result.value += metrics->counters[counter].load(std::memory_order_relaxed);
+            }
+        }
+        for (size_t histogram = 0; histogram < histogram_names_.size(); ++histogram) {
+            LatencyHistogramSnapshot& result = snapshot.histograms.emplace_back();
+            result.name = histogram_names_[histogram];
+            result.buckets.assign(BUCKET_COUNT, 0);
+            for (const auto& metrics : threads_) {
+                const HistogramData* const data = metrics->histograms[histogram].load(std::memory_order_acquire);
+                if (data == nullptr) {
+                    continue;
+                }
+                for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+                    result.buckets[bucket] += data->buckets[bucket].load(std::memory_order_relaxed);
+                }
+                result.count += data->count.load(std::memory_order_relaxed);
+                result.sum_ns += data->sum.load(std::memory_order_relaxed);
+                result.max_ns = std::max(result.max_ns, data->max.load(std::memory_order_relaxed));
+            }
+        }
+        return snapshot;
+    }
+private:
+    std::mutex mutex_;
+    std::vector<std::string> counter_names_;
+    std::vector<std::string> histogram_names_;
+    std::vector<std::unique_ptr<ThreadMetrics>> threads_;
+    std::vector<ThreadMetrics*> free_threads_;
+
+    size_t Register(std::vector<std::string>& names, std::string_view name) {
+        std::lock_guard guard(mutex_);
+        const auto it = std::find(names.begin(), names.end(), name);
+        if (it != names.end()) {
+            return it - names.begin();
+        }
+        if (names.size() == MAX_METRICS) {
+            throw std::length_error("Too many metrics"s);
+        }
+        names.emplace_back(name);
+        return names.size() - 1;
+    }
+};
+
+struct ThreadMetricsHandle {
+    ThreadMetrics* const metrics = MetricsRegistry::GetInstance().AcquireThreadMetrics();
+
+    ~ThreadMetricsHandle() {
+        MetricsRegistry::GetInstance().ReleaseThreadMetrics(metrics);
+    }
+};
+
+ThreadMetrics& GetThreadMetrics() {
+    thread_local ThreadMetricsHandle handle;
+    return *handle.metrics;
+}
+}
+
+uint64_t LatencyHistogramSnapshot::GetValueAtPercentile(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * count)));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= rank) {
+            return std::min(Buckets::GetUpperBound(bucket), max_ns);
+        }
+    }
+    return max_ns;
+}
+
+double LatencyHistogramSnapshot::GetMean() const {
+    return count == 0 ? 0.0 : static_cast<double>(sum_ns) / count;
+}
+
+size_t RegisterCounter(std::string_view name) {
+    return MetricsRegistry::GetInstance().RegisterCounter(name);
+}
+
+size_t RegisterLatencyHistogram(std::string_view name) {
+    return MetricsRegistry::GetInstance().RegisterHistogram(name);
+}
+
+void AddToCounter(size_t counter, uint64_t value) {
+    Increment(GetThreadMetrics().counters[counter], value);
+}
+
+void RecordLatency(size_t histogram, uint64_t nanoseconds) {
+    std::atomic<HistogramData*>& slot = GetThreadMetrics().histograms[histogram];
+    HistogramData* data = slot.load(std::memory_order_relaxed);
+    if (data == nullptr) {
+        data = new HistogramData();
+        slot.store(data, std::memory_order_release);
+    }
+    Increment(data->buckets[Buckets::GetBucket(nanoseconds)], 1);
+    Increment(data->count, 1);
+    Increment(data->sum, nanoseconds);
+    if (nanoseconds > data->max.load(std::memory_order_relaxed)) {
+        data->max.store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+MetricsSnapshot GetMetricsSnapshot() {
+    return MetricsRegistry::GetInstance().GetSnapshot();
+}
+
+void PrintMetrics(std::ostream& out) {
+    const MetricsSnapshot snapshot = GetMetricsSnapshot();
+    for (const CounterSnapshot& counter : snapshot.counters) {
+        if (counter.value != 0) {
+            out << counter.name << ": "sv << counter.value << std::endl;
+        }
+    }
+    for (const LatencyHistogramSnapshot& histogram : snapshot.histograms) {
+        if (histogram.count == 0) {
+            continue;
+        }
+        out << histogram.name << ": count="sv << histogram.count
+            << " mean="sv << static_cast<uint64_t>(histogram.GetMean()) << "ns"sv
+            << " p50="sv << histogram.GetValueAtPercentile(50.0) << "ns"sv
+            << " p99="sv << histogram.GetValueAtPercentile(99.0) << "ns"sv
+            << " p999="sv << histogram.GetValueAtPercentile(99.9) << "ns"sv
+            << " max="sv << histogram.max_ns << "ns"sv << std::endl;
+    }
+}
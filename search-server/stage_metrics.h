@@ -0,0 +1,105 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Счётчики и гистограммы задержек этапов обработки запросов.
+//
+// Каждый поток пишет в собственный набор значений без блокировок и атомарных read-modify-write операций;
+// GetMetricsSnapshot суммирует наборы всех потоков. Гистограмма логарифмически-линейная, как HDR Histogram:
+// значения в наносекундах хранятся с относительной погрешностью не больше 1/32.
+//
+// Пример использования:
+//
+//  void Parse() {
+//      STAGE_TIMER("parser.parse"); // время до конца блока попадёт в гистограмму parser.parse
+//      STAGE_COUNTER_ADD("parser.tokens", tokens.size());
+//      ...
+//  }
+//
+// Если определён SEARCH_SERVER_DISABLE_METRICS, макросы не генерируют никакого кода.
+
+struct LatencyHistogramSnapshot {
+    std::string name;
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+    std::vector<uint64_t> buckets; //число значений в каждом интервале гистограммы
+
+    // Наименьшее значение, не меньше которого percentile процентов записанных (с погрешностью гистограммы)
+    uint64_t GetValueAtPercentile(double percentile) const;
+
+    double GetMean() const;
+};
+
+struct CounterSnapshot {
+    std::string name;
+    uint64_t value = 0;
+};
+
+struct MetricsSnapshot {
+    std::vector<CounterSnapshot> counters;
+    std::vector<LatencyHistogramSnapshot> histograms;
+};
+
+// Регистрирует метрику или возвращает номер уже зарегистрированной с тем же именем.
+// Число метрик каждого вида ограничено MAX_METRICS; при превышении бросает std::length_error
+size_t RegisterCounter(std::string_view name);
+
+size_t RegisterLatencyHistogram(std::string_view name);
+
+void AddToCounter(size_t counter, uint64_t value);
+
+void RecordLatency(size_t histogram, uint64_t nanoseconds);
+
+// Сумма значений всех потоков, включая завершившиеся
+MetricsSnapshot GetMetricsSnapshot();
+
+// Выводит непустые метрики по одной в строке: счётчики - значением, гистограммы - числом замеров и перцентилями
+void PrintMetrics(std::ostream& out);
+
+const size_t MAX_METRICS = 64;
+
+// Записывает время жизни объекта в гистограмму
+class StageTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StageTimer(size_t histogram) : histogram_(histogram) {
+    }
+
+    StageTimer(const StageTimer&) = delete;
+
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    ~StageTimer() {
+        RecordLatency(histogram_, static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time_).count()));
+    }
+private:
+    const size_t histogram_;
+    const Clock::time_point start_time_ = Clock::now();
+};
+
+#define STAGE_METRICS_CONCAT_INTERNAL(X, Y) X##Y
+#define STAGE_METRICS_CONCAT(X, Y) STAGE_METRICS_CONCAT_INTERNAL(X, Y)
+
+#ifdef SEARCH_SERVER_DISABLE_METRICS
+#define STAGE_TIMER(name) ((void)0)
+#define STAGE_COUNTER_ADD(name, value) ((void)0)
+#else
+// Номер метрики вычисляется один раз для каждого места вызова
+#define STAGE_TIMER(name)                                                                                     \
+    static const size_t STAGE_METRICS_CONCAT(stage_histogram_, __LINE__) = RegisterLatencyHistogram(name);   \
+    StageTimer STAGE_METRICS_CONCAT(stage_timer_, __LINE__)(STAGE_METRICS_CONCAT(stage_histogram_, __LINE__))
+
+#define STAGE_COUNTER_ADD(name, value)                                                                        \
+    do {                                                                                                      \
+        static const size_t stage_counter = RegisterCounter(name);                                           \
+        AddToCounter(stage_counter, static_cast<uint64_t>(value));                                            \
+    } while (false)
+#endif
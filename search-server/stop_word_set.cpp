@@ -0,0 +1,98 @@
+#include "stop_word_set.h"
+#include <cstring>
+
+namespace {
+constexpr size_t FILTER_BLOCK_WORDS = 8;
+
+// Бит фильтра выбирается из разных частей хэша: номер 64-битного слова в блоке и номер бита в нём
+void GetFilterBit(uint64_t hash, int index, size_t& word, uint64_t& mask) {
+    const uint64_t bits = hash >> (16 + index * 9);
+    word = bits & (FILTER_BLOCK_WORDS - 1);
+    mask = uint64_t{ 1 } << ((bits >> 3) & 63);
+}
+}
+
+StopWordSet::StopWordSet(const std::set<std::string, std::less<>>& words) :
+        size_(words.size()) {
+    if (words.empty()) {
+        return;
+    }
+    size_t capacity = 1;
+    while (capacity < words.size() * 2) {
+        capacity *= 2;
+    }
+    slots_.resize(capacity);
+    // Примерно 16 бит фильтра на слово
+    size_t filter_blocks = 1;
+    while (filter_blocks * FILTER_BLOCK_WORDS * 64 < words.size() * 16) {
+        filter_blocks *= 2;
+    }
+    filter_.assign(filter_blocks * FILTER_BLOCK_WORDS, 0);
+
+    for (const std::string& word : words) {
+        const uint64_t hash = Hash(word);
+        const size_t block = (hash & (filter_blocks - 1)) * FILTER_BLOCK_WORDS;
+        for (int i = 0; i < 3; ++i) {
+            size_t filter_word;
+            uint64_t mask;
+            GetFilterBit(hash, i, filter_word, mask);
+            filter_[block + filter_word] |= mask;
+        }
+        size_t index = (hash >> 32) & (capacity - 1);
+        while (slots_[index].length != 0) {
+            index = (index + 1) & (capacity - 1);
+        }
+        slots_[index] = { hash, static_cast<uint32_t>(text_.size()), static_cast<uint32_t>(word.size()) };
+        text_ += word;
+    }
+}
+
+bool StopWordSet::Contains(std::string_view word) const {
+    if (size_ == 0 || word.empty()) {
+        return false;
+    }
+    const uint64_t hash = Hash(word);
+    if (!MayContain(hash)) {
+        return false;
+    }
+    const size_t mask = slots_.size() - 1;
+    for (size_t index = (hash >> 32) & mask;; index = (index + 1) & mask) {
+        const Slot& slot = slots_[index];
+        if (slot.length == 0) {
+            return false;
+        }
+        if (slot.hash == hash && slot.length == word.size()
+            && std::memcmp(text_.data() + slot.offset, word.data(), word.size()) == 0) {
+            return true;
+        }
+    }
+}
+
+size_t StopWordSet::size() const {
+    return size_;
+}
+
+uint64_t StopWordSet::Hash(std::string_view word) {
+    // FNV-1a с финальным перемешиванием, чтобы старшие и младшие биты были одинаково случайны
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (const char c : word) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+bool StopWordSet::MayContain(uint64_t hash) const {
+    const size_t block = (hash & (filter_.size() / FILTER_BLOCK_WORDS - 1)) * FILTER_BLOCK_WORDS;
+    for (int i = 0; i < 3; ++i) {
+        size_t filter_word;
+        uint64_t mask;
+        GetFilterBit(hash, i, filter_word, mask);
+        if ((filter_[block + filter_word] & mask) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Неизменяемое множество стоп-слов, построенное один раз при создании сервера.
+// Проверка слова: блочный фильтр Блума в одной кэш-линии отсекает почти все слова не из множества,
+// остальные ищутся в таблице с открытой адресацией, заполненной не более чем наполовину
+class StopWordSet {
+public:
+    StopWordSet() = default;
+
+    explicit StopWordSet(const std::set<std::string, std::less<>>& words);
+
+    bool Contains(std::string_view word) const;
+
+    size_t size() const;
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        uint32_t offset = 0;
+        uint32_t length = 0; //0 - свободная ячейка: стоп-слова не бывают пустыми
+    };
+
+    std::string text_; //все слова подряд; ячейки ссылаются на них по смещению
+    std::vector<Slot> slots_; //размер - степень двойки
+    std::vector<uint64_t> filter_; //по 8 слов (512 бит) на блок
+    size_t size_ = 0;
+
+    static uint64_t Hash(std::string_view word);
+
+    bool MayContain(uint64_t hash) const;
+};
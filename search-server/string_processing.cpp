@@ -1,7 +1,113 @@
 #include "string_processing.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define SEARCH_SERVER_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 using std::literals::string_literals::operator""s;
 
+namespace {
+// Текст просматривается блоками: для каждого блока строятся битовые маски пробелов и управляющих символов
+#if defined(__AVX2__)
+constexpr size_t BLOCK_SIZE = 32;
+
+void ClassifyBlock(const char* data, uint32_t& spaces, uint32_t& controls) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    spaces = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '))));
+    // Сравнение знаковое: байты 128-255 отрицательны и под условие 0 <= c < ' ' не попадают
+    const __m256i below_space = _mm256_cmpgt_epi8(_mm256_set1_epi8(' '), block);
+    const __m256i non_negative = _mm256_cmpgt_epi8(block, _mm256_set1_epi8(-1));
+    controls = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(below_space, non_negative)));
+}
+#elif defined(SEARCH_SERVER_SSE2)
+constexpr size_t BLOCK_SIZE = 16;
+
+void ClassifyBlock(const char* data, uint32_t& spaces, uint32_t& controls) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    spaces = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(' '))));
+    // Сравнение знаковое: байты 128-255 отрицательны и под условие 0 <= c < ' ' не попадают
+    const __m128i below_space = _mm_cmplt_epi8(block, _mm_set1_epi8(' '));
+    const __m128i non_negative = _mm_cmpgt_epi8(block, _mm_set1_epi8(-1));
+    controls = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(below_space, non_negative)));
+}
+#else
+constexpr size_t BLOCK_SIZE = 16;
+
+void ClassifyBlock(const char* data, uint32_t& spaces, uint32_t& controls) {
+    spaces = 0;
+    controls = 0;
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+        spaces |= static_cast<uint32_t>(c == ' ') << i;
+        controls |= static_cast<uint32_t>(c < ' ') << i;
+    }
+}
+#endif
+
+constexpr uint32_t BLOCK_MASK = BLOCK_SIZE == 32 ? UINT32_MAX : (1u << BLOCK_SIZE) - 1;
+
+int CountTrailingZeros(uint32_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+// Один проход по тексту: слова - максимальные отрезки без пробелов, их границы находятся по битовым маскам блока
+template <bool Validate>
+bool ScanWords(std::string_view text, std::vector<std::string_view>& words) {
+    words.clear();
+    const char* const data = text.data();
+    const size_t size = text.size();
+    char last_block[BLOCK_SIZE];
+    size_t word_begin = 0;
+    bool in_word = false;
+    for (size_t offset = 0; offset < size; offset += BLOCK_SIZE) {
+        const char* block = data + offset;
+        if (size - offset < BLOCK_SIZE) {
+            // Неполный последний блок дополняется пробелами, которые завершают последнее слово
+            std::memset(last_block, ' ', BLOCK_SIZE);
+            std::memcpy(last_block, block, size - offset);
+            block = last_block;
+        }
+        uint32_t spaces;
+        uint32_t controls;
+        ClassifyBlock(block, spaces, controls);
+        if (Validate && controls != 0) {
+            return false;
+        }
+        const uint32_t letters = ~spaces & BLOCK_MASK;
+        // Бит границы стоит там, где байт отличается от предыдущего: пробел сменяется буквой или наоборот
+        uint32_t boundaries = (letters ^ ((letters << 1) | static_cast<uint32_t>(in_word))) & BLOCK_MASK;
+        while (boundaries != 0) {
+            const size_t pos = offset + CountTrailingZeros(boundaries);
+            if (in_word) {
+                words.emplace_back(data + word_begin, pos - word_begin);
+            }
+            else {
+                word_begin = pos;
+            }
+            in_word = !in_word;
+            boundaries &= boundaries - 1;
+        }
+    }
+    if (in_word) {
+        words.emplace_back(data + word_begin, size - word_begin);
+    }
+    return true;
+}
+}
+
 std::vector<std::string> SplitIntoWords(std::string_view text) {
     std::vector<std::string> words;
     std::string word;
@@ -24,14 +130,33 @@ std::vector<std::string> SplitIntoWords(std::string_view text) {
 
 std::vector<std::string_view> SplitIntoWordsView(std::string_view str) {
     std::vector<std::string_view> result;
-    str.remove_prefix(std::min(str.size(), str.find_first_not_of(" ")));
-    const int64_t pos_end = str.npos;
+    SplitIntoWordsView(str, result);
+    return result;
+}
 
-    while (!str.empty()) {
-        int64_t space = str.find(' ');
-        result.push_back(space == pos_end ? str.substr(0) : str.substr(0, space));
-        str.remove_prefix(std::min(str.size(), str.find_first_not_of(" ", space)));
-    }
+void SplitIntoWordsView(std::string_view text, std::vector<std::string_view>& words) {
+    ScanWords<false>(text, words);
+}
 
-    return result;
-}
\ No newline at end of file
+bool SplitIntoValidWordsView(std::string_view text, std::vector<std::string_view>& words) {
+    return ScanWords<true>(text, words);
+}
+
+bool ContainsControlCharacters(std::string_view text) {
+    char last_block[BLOCK_SIZE];
+    for (size_t offset = 0; offset < text.size(); offset += BLOCK_SIZE) {
+        const char* block = text.data() + offset;
+        if (text.size() - offset < BLOCK_SIZE) {
+            std::memset(last_block, ' ', BLOCK_SIZE);
+            std::memcpy(last_block, block, text.size() - offset);
+            block = last_block;
+        }
+        uint32_t spaces;
+        uint32_t controls;
+        ClassifyBlock(block, spaces, controls);
+        if (controls != 0) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,9 +1,20 @@
 #pragma once
 #include <algorithm>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <stdexcept>
 #include <set>
 
 std::vector<std::string> SplitIntoWords(std::string_view text);
 
-std::vector<std::string_view> SplitIntoWordsView(std::string_view str);
\ No newline at end of file
+std::vector<std::string_view> SplitIntoWordsView(std::string_view str);
+
+// Слова записываются в words; память вектора переиспользуется между вызовами
+void SplitIntoWordsView(std::string_view text, std::vector<std::string_view>& words);
+
+// Разбивает текст на слова и за тот же проход проверяет, что в нём нет управляющих символов (коды 0-31).
+// Возвращает false, если такой символ найден; содержимое words в этом случае не определено
+bool SplitIntoValidWordsView(std::string_view text, std::vector<std::string_view>& words);
+
+bool ContainsControlCharacters(std::string_view text);
@@ -0,0 +1,81 @@
+#include "term_dictionary.h"
+#include <utility>
+
+uint32_t TermDictionary::Intern(std::string_view term) {
+    auto it = term_to_id_.find(term);
+    if (it != term_to_id_.end()) {
+        return it->second;
+    }
+    const std::string_view stored = storage_.Store(term);
+    uint32_t term_id;
+    if (!free_ids_.empty()) {
+        term_id = free_ids_.back();
+        free_ids_.pop_back();
+        id_to_term_[term_id] = stored;
+    }
+    else {
+        term_id = static_cast<uint32_t>(id_to_term_.size());
+        id_to_term_.push_back(stored);
+    }
+    term_to_id_.emplace(stored, term_id);
+    return term_id;
+}
+
+uint32_t TermDictionary::Find(std::string_view term) const {
+    auto it = term_to_id_.find(term);
+    return it == term_to_id_.end() ? NO_TERM : it->second;
+}
+
+std::string_view TermDictionary::GetTerm(uint32_t term_id) const {
+    return id_to_term_[term_id];
+}
+
+void TermDictionary::Release(uint32_t term_id) {
+    const std::string_view term = id_to_term_[term_id];
+    term_to_id_.erase(term);
+    storage_.Release(term);
+    id_to_term_[term_id] = {};
+    free_ids_.push_back(term_id);
+}
+
+void TermDictionary::Compact() {
+    TextArena storage;
+    term_to_id_.clear();
+    for (uint32_t term_id = 0; term_id < id_to_term_.size(); ++term_id) {
+        std::string_view& term = id_to_term_[term_id];
+        if (storage_.Owns(term)) {
+            term = storage.Store(term);
+        }
+        if (!term.empty()) {
+            term_to_id_.emplace(term, term_id);
+        }
+    }
+    storage_ = std::move(storage);
+}
+
+size_t TermDictionary::GetLiveBytes() const {
+    return storage_.GetLiveBytes();
+}
+
+size_t TermDictionary::GetReleasedBytes() const {
+    return storage_.GetReleasedBytes();
+}
+
+void TermDictionary::Restore(const std::vector<std::string_view>& terms) {
+    id_to_term_ = terms;
+    term_to_id_.clear();
+    term_to_id_.reserve(terms.size());
+    free_ids_.clear();
+    for (uint32_t term_id = 0; term_id < terms.size(); ++term_id) {
+        if (terms[term_id].empty()) {
+            free_ids_.push_back(term_id);
+        }
+        else {
+            term_to_id_.emplace(terms[term_id], term_id);
+        }
+    }
+}
+
+size_t TermDictionary::size() const {
+    return id_to_term_.size();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "text_arena.h"
+
+// Словарь терминов: слово -> плотный целочисленный id и обратно
+class TermDictionary {
+public:
+    static constexpr uint32_t NO_TERM = UINT32_MAX;
+
+    uint32_t Intern(std::string_view term);
+
+    uint32_t Find(std::string_view term) const;
+
+    std::string_view GetTerm(uint32_t term_id) const;
+
+    // Удаляет слово из словаря; id будет выдан следующему новому слову.
+    // Текст слова остаётся в памяти и выданные на него string_view действительны до вызова Compact
+    void Release(uint32_t term_id);
+
+    // Переносит тексты слов в новое хранилище без освобождённых слов. Делает недействительными все string_view,
+    // полученные из словаря раньше, кроме текстов, переданных в Restore
+    void Compact();
+
+    size_t GetLiveBytes() const;
+
+    // Байты текстов удалённых слов, которые вернёт Compact
+    size_t GetReleasedBytes() const;
+
+    // Восстанавливает словарь по таблице id -> слово; пустые слова соответствуют свободным id.
+    // Тексты слов не копируются и должны жить дольше словаря
+    void Restore(const std::vector<std::string_view>& terms);
+
+    // Размер пространства id (включая освобождённые id)
+    size_t size() const;
+private:
+    TextArena storage_;
+    std::vector<std::string_view> id_to_term_;
+    std::unordered_map<std::string_view, uint32_t> term_to_id_;
+    std::vector<uint32_t> free_ids_;
+};
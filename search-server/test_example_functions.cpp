@@ -17,6 +17,11 @@ void AssertImpl(bool value, const std::string& expr_str, const std::string& file
     }
 }
 
+uint32_t NextRandom(uint32_t& seed) {
+    seed = seed * 1103515245u + 12345u;
+    return seed;
+}
+
 #define ASSERT(expr) AssertImpl((expr), #expr, __FILE__, __FUNCTION__, __LINE__, ""s)
 
 #define ASSERT_HINT(expr, hint) AssertImpl((expr), #expr, __FILE__, __FUNCTION__, __LINE__, (hint))
@@ -292,7 +297,7 @@ void TestGetWordFrequencies() {
 }
 
 //    -  
-/*void TestRemoveDuplicates() {
+void TestRemoveDuplicates() {
     const int doc_id = 42;
     const std::string content = "purple cat purple eyes"s;
     const std::vector<int> ratings = { 1, 2, 3 };
@@ -308,17 +313,69 @@ void TestGetWordFrequencies() {
         server.AddDocument(doc_id2, content2, DocumentStatus::ACTUAL, ratings2);
         const auto found1 = server.FindTopDocuments("purple dog"s);
         ASSERT_EQUAL(found1.size(), 2);
-        RemoveDuplicates(server);
+        ASSERT(RemoveDuplicates(server).empty());
         const auto found2 = server.FindTopDocuments("purple dog"s);
         ASSERT_EQUAL(found2.size(), 2);
         server.AddDocument(doc_id3, content3, DocumentStatus::ACTUAL, ratings3);
         const auto found3 = server.FindTopDocuments("purple dog"s);
         ASSERT_EQUAL(found3.size(), 3);
-        RemoveDuplicates(server);
+        const auto removed = RemoveDuplicates(server);
+        ASSERT_EQUAL(removed.size(), 1);
+        ASSERT_EQUAL(removed[0].document_id, doc_id3);
+        ASSERT_EQUAL(removed[0].original_id, doc_id2);
         const auto found4 = server.FindTopDocuments("purple dog"s);
         ASSERT_EQUAL(found4.size(), 2);
     }
-}*/
+    {
+        //            ,   -
+        SearchServer server("in the and"s);
+        server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+        server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+        server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+        server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+        server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+        server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+        server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, { 1, 2 });
+        server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+        server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+        const auto duplicates = FindDuplicates(server);
+        ASSERT_EQUAL(server.GetDocumentCount(), 9);
+        const std::vector<std::pair<int, int>> expected = { { 3, 2 }, { 5, 1 }, { 7, 6 } };
+        ASSERT_EQUAL(duplicates.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(duplicates[i].document_id, expected[i].first);
+            ASSERT_EQUAL(duplicates[i].original_id, expected[i].second);
+        }
+        ASSERT_EQUAL(RemoveDuplicates(server).size(), expected.size());
+        ASSERT_EQUAL(server.GetDocumentCount(), 6);
+        ASSERT(server.GetTermIds(3).empty());
+        ASSERT(FindDuplicates(server).empty());
+    }
+    {
+        //       id   ,   
+        SearchServer server("in the and"s);
+        for (int id = 0; id < 300; ++id) {
+            server.AddDocument(id, id % 2 == 0 ? "white cat"s : "black dog"s, DocumentStatus::ACTUAL, { id });
+        }
+        server.AddDocument(300, "unique parrot"s, DocumentStatus::ACTUAL, { 1 });
+        std::vector<int> removed_ids = { 300, 1000, 300 };
+        for (int id = 0; id < 300; id += 3) {
+            removed_ids.push_back(id);
+        }
+        server.RemoveDocuments(removed_ids);
+        ASSERT_EQUAL(server.GetDocumentCount(), 200);
+        ASSERT(server.FindTopDocuments("parrot"s).empty());
+        const auto cats = server.FindTopDocuments("white cat"s, DocumentStatus::ACTUAL, 1000);
+        ASSERT_EQUAL(cats.size(), 100);
+        for (const Document& document : cats) {
+            ASSERT(document.id % 2 == 0 && document.id % 3 != 0);
+        }
+        ASSERT_EQUAL(server.FindTopDocuments("black dog"s, DocumentStatus::ACTUAL, 1000).size(), 100);
+        server.AddDocument(301, "unique parrot"s, DocumentStatus::ACTUAL, { 1 });
+        ASSERT_EQUAL(server.FindTopDocuments("parrot"s).size(), 1);
+        ASSERT_EQUAL(server.GetTermIds(301).size(), 2);
+    }
+}
 
 //     
 void TestRequestQueue() {
@@ -334,7 +391,7 @@ void TestRequestQueue() {
         for (int i = 0; i < 1439; ++i) {
             queue.AddFindRequest("empty request"s);
         }
-        ASSERT_EQUAL(queue.GetNoResultRequests(), 1440);
+        ASSERT_EQUAL(queue.GetNoResultRequests(), 1439);
         server.AddDocument(doc_id, content, DocumentStatus::ACTUAL, ratings);
         server.AddDocument(doc_id2, content2, DocumentStatus::ACTUAL, ratings2);
         queue.AddFindRequest("black cat white tail"s);
@@ -343,6 +400,1147 @@ void TestRequestQueue() {
     }
 }
 
+// ,      
+void TestTopDocumentsCount() {
+    const std::vector<int> ratings = { 1, 2, 3 };
+    {
+        SearchServer server("in the"s);
+        for (int id = 0; id < 10; ++id) {
+            server.AddDocument(id, "purple cat number "s + std::to_string(id), DocumentStatus::ACTUAL, { id });
+        }
+        server.AddDocument(10, "purple dog"s, DocumentStatus::BANNED, ratings);
+        ASSERT_EQUAL(server.FindTopDocuments("purple cat"s).size(), MAX_RESULT_DOCUMENT_COUNT);
+        const auto found = server.FindTopDocuments("purple cat"s, DocumentStatus::ACTUAL, 3);
+        ASSERT_EQUAL(found.size(), 3);
+        ASSERT_EQUAL(found[0].id, 9);
+        ASSERT_EQUAL(found[1].id, 8);
+        ASSERT_EQUAL(found[2].id, 7);
+        const auto found_par = server.FindTopDocuments(std::execution::par, "purple cat"s, DocumentStatus::ACTUAL, 3);
+        ASSERT_EQUAL(found_par.size(), 3);
+        ASSERT_EQUAL(found_par[0].id, 9);
+        const auto found_all = server.FindTopDocuments("purple"s, [](int, DocumentStatus, int)
+            { return true; }, 100);
+        ASSERT_EQUAL(found_all.size(), 11);
+        ASSERT(server.FindTopDocuments("purple cat"s, DocumentStatus::ACTUAL, 0).empty());
+    }
+    {
+        //            id
+        //    ,          
+        SearchServer server("in the"s);
+        for (int id = 5000; id >= 0; id -= 5) {
+            server.AddDocument(id, "grey cat"s, DocumentStatus::ACTUAL, ratings);
+        }
+        const std::vector<int> expected = { 0, 5, 10, 15 };
+        for (const RetrievalMode mode : { RetrievalMode::EXHAUSTIVE, RetrievalMode::MAX_SCORE }) {
+            server.SetRetrievalMode(mode);
+            for (const auto& found : { server.FindTopDocuments("grey cat"s, DocumentStatus::ACTUAL, 4),
+                server.FindTopDocuments(std::execution::par, "grey cat"s, DocumentStatus::ACTUAL, 4) }) {
+                ASSERT_EQUAL(found.size(), expected.size());
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    ASSERT_EQUAL(found[i].id, expected[i]);
+                }
+            }
+        }
+    }
+}
+
+// ,     MaxScore    ,    
+void TestMaxScoreRetrieval() {
+    const std::vector<std::string> dictionary = { "cat"s, "dog"s, "bird"s, "fish"s, "tail"s, "paw"s, "fur"s, "wing"s,
+        "eye"s, "ear"s, "nose"s, "fin"s };
+    uint32_t seed = 17;
+    const auto next_word = [&]() {
+        return dictionary[(NextRandom(seed) >> 16) % dictionary.size()];
+    };
+    SearchServer server("in the"s);
+    for (int id = 0; id < 300; ++id) {
+        std::string text;
+        for (int i = 0; i < 2 + id % 7; ++i) {
+            text += next_word() + " "s;
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 13, id % 5 });
+    }
+    const std::vector<std::string> queries = { "cat dog"s, "bird fish tail paw fur"s, "wing -eye ear"s,
+        "nose fin cat -dog"s, "cat dog bird fish tail paw fur wing eye ear nose fin"s };
+    for (const std::string& query : queries) {
+        for (const size_t top_k : { 1u, 5u, 20u }) {
+            server.SetRetrievalMode(RetrievalMode::EXHAUSTIVE);
+            const auto expected = server.FindTopDocuments(query, DocumentStatus::ACTUAL, top_k);
+            server.SetRetrievalMode(RetrievalMode::MAX_SCORE);
+            const auto found = server.FindTopDocuments(query, DocumentStatus::ACTUAL, top_k);
+            ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL_HINT(found[i].id, expected[i].id, query);
+                ASSERT_EQUAL_HINT(found[i].relevance, expected[i].relevance, query);
+            }
+        }
+    }
+    const auto found_odd = server.FindTopDocuments("cat dog"s, [](int document_id, DocumentStatus, int)
+        { return document_id % 2 == 1; });
+    for (const Document& document : found_odd) {
+        ASSERT_EQUAL(document.id % 2, 1);
+    }
+}
+
+//         
+void TestTextArena() {
+    {
+        TextArena arena(16);
+        const std::string_view cat = arena.Store("cat"s);
+        const std::string_view panda = arena.Store("panda"s);
+        ASSERT_EQUAL(cat, "cat"s);
+        ASSERT_EQUAL(panda, "panda"s);
+        ASSERT_EQUAL(arena.GetLiveBytes(), 8);
+        arena.Release(cat);
+        ASSERT_EQUAL(arena.GetLiveBytes(), 5);
+        ASSERT_EQUAL(arena.GetReleasedBytes(), 3);
+        //     
+        const std::string_view dog = arena.Store("dog"s);
+        ASSERT(dog.data() != cat.data());
+        ASSERT_EQUAL(cat, "cat"s);
+        ASSERT_EQUAL(panda, "panda"s);
+        const std::string_view long_text = arena.Store("very long text that does not fit into a slab"s);
+        ASSERT_EQUAL(long_text, "very long text that does not fit into a slab"s);
+        ASSERT(arena.Owns(long_text));
+        arena.Release(long_text);
+        ASSERT_EQUAL(long_text, "very long text that does not fit into a slab"s);
+        const std::string foreign = "not from arena"s;
+        ASSERT(!arena.Owns(foreign));
+        arena.Release(foreign);
+        ASSERT_EQUAL(arena.GetLiveBytes(), 8);
+    }
+    {
+        // Compact          
+        TermDictionary terms;
+        const uint32_t cat = terms.Intern("cat"s);
+        const uint32_t panda = terms.Intern("panda"s);
+        terms.Release(cat);
+        ASSERT_EQUAL(terms.GetReleasedBytes(), 3);
+        ASSERT_EQUAL(terms.Find("cat"s), TermDictionary::NO_TERM);
+        terms.Compact();
+        ASSERT_EQUAL(terms.GetReleasedBytes(), 0);
+        ASSERT_EQUAL(terms.GetLiveBytes(), 5);
+        ASSERT_EQUAL(terms.GetTerm(panda), "panda"s);
+        ASSERT_EQUAL(terms.Find("panda"s), panda);
+        ASSERT_EQUAL(terms.Intern("dog"s), cat);
+        ASSERT_EQUAL(terms.Find("dog"s), cat);
+    }
+    {
+        SearchServer server("in the"s);
+        server.AddDocument(1, "white cat with fluffy tail"s, DocumentStatus::ACTUAL, { 1 });
+        server.AddDocument(2, "black dog with long tail"s, DocumentStatus::ACTUAL, { 2 });
+        server.RemoveDocument(1);
+        ASSERT(server.FindTopDocuments("fluffy"s).empty());
+        const auto [words, status] = server.MatchDocument("dog tail cat"s, 2);
+        ASSERT_EQUAL(words.size(), 2);
+        ASSERT_EQUAL(words[0], "dog"s);
+        ASSERT_EQUAL(words[1], "tail"s);
+        server.AddDocument(3, "fluffy cat"s, DocumentStatus::ACTUAL, { 3 });
+        ASSERT_EQUAL(server.FindTopDocuments("fluffy"s).size(), 1);
+        ASSERT_EQUAL(server.GetWordFrequencies(3).at("fluffy"s), 0.5);
+        ASSERT_EQUAL(server.GetWordFrequencies(2).size(), 5);
+    }
+}
+
+// ,       ,   
+void TestParallelFindTopDocuments() {
+    const std::vector<std::string> dictionary = { "cat"s, "dog"s, "bird"s, "fish"s, "tail"s, "paw"s, "fur"s, "wing"s };
+    uint32_t seed = 5;
+    const auto next_word = [&]() {
+        return dictionary[(NextRandom(seed) >> 16) % dictionary.size()];
+    };
+    SearchServer server("in the"s);
+    for (int i = 0; i < 500; ++i) {
+        std::string text;
+        for (int j = 0; j < 1 + i % 6; ++j) {
+            text += next_word() + " "s;
+        }
+        //  id,        
+        server.AddDocument(i * 997, text, i % 3 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { i % 11, i % 7 });
+    }
+    const std::vector<std::string> queries = { "cat"s, "dog bird -fish"s, "tail paw fur wing"s, "cat dog -cat"s };
+    for (const std::string& query : queries) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const auto expected = server.FindTopDocuments(std::execution::seq, query, status, 50);
+            const auto found = server.FindTopDocuments(std::execution::par, query, status, 50);
+            ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+            //         ,   
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL_HINT(found[i].relevance, expected[i].relevance, query);
+                ASSERT_EQUAL_HINT(found[i].rating, expected[i].rating, query);
+            }
+        }
+    }
+}
+
+//         
+void TestSnapshot() {
+    const std::string path = "search_server_test_snapshot.bin"s;
+    {
+        SearchServer server("in the and"s);
+        server.AddDocument(42, "purple cat purple eyes"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
+        server.AddDocument(43, "small cowardly purple dog"s, DocumentStatus::BANNED, { 1, -1, 3 });
+        server.AddDocument(44, "big brave kind panda and orange cat"s, DocumentStatus::ACTUAL, { 10, 10, 10 });
+        server.AddDocument(45, "orange fish"s, DocumentStatus::ACTUAL, { 4 });
+        server.RemoveDocument(45);
+        server.SaveSnapshot(path);
+
+        SearchServer loaded = SearchServer::LoadSnapshot(path);
+        ASSERT_EQUAL(loaded.GetDocumentCount(), 3);
+        ASSERT(std::vector<int>(loaded.begin(), loaded.end()) == std::vector<int>({ 42, 43, 44 }));
+        for (const std::string& query : { "purple cat"s, "orange -cat"s, "in the"s, "panda eyes dog"s }) {
+            const auto expected = server.FindTopDocuments(query);
+            const auto found = loaded.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL_HINT(found[i].id, expected[i].id, query);
+                ASSERT_EQUAL_HINT(found[i].relevance, expected[i].relevance, query);
+                ASSERT_EQUAL_HINT(found[i].rating, expected[i].rating, query);
+            }
+        }
+        ASSERT_EQUAL(loaded.FindTopDocuments("dog"s, DocumentStatus::BANNED).size(), 1);
+        ASSERT_EQUAL(loaded.GetWordFrequencies(42).at("purple"s), 0.5);
+        ASSERT_EQUAL(std::get<0>(loaded.MatchDocument("cat eyes -dog"s, 42)).size(), 2);
+
+        //    
+        loaded.AddDocument(46, "purple fish"s, DocumentStatus::ACTUAL, { 5 });
+        loaded.RemoveDocument(42);
+        const auto found = loaded.FindTopDocuments("purple"s);
+        ASSERT_EQUAL(found.size(), 1);
+        ASSERT_EQUAL(found[0].id, 46);
+        ASSERT(loaded.FindTopDocuments("eyes"s).empty());
+
+        //             :
+        //       ,    
+        loaded.SaveSnapshot(path);
+        ASSERT(!std::ifstream(path + ".tmp"s));
+        SearchServer reloaded = SearchServer::LoadSnapshot(path);
+        ASSERT(std::vector<int>(reloaded.begin(), reloaded.end()) == std::vector<int>({ 43, 44, 46 }));
+        for (const std::string& query : { "purple cat"s, "orange -cat"s, "fish"s, "panda eyes dog"s }) {
+            const auto expected = loaded.FindTopDocuments(query);
+            const auto reloaded_found = reloaded.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(reloaded_found.size(), expected.size(), query);
+            for (size_t i = 0; i < reloaded_found.size(); ++i) {
+                ASSERT_EQUAL_HINT(reloaded_found[i].id, expected[i].id, query);
+                ASSERT_EQUAL_HINT(reloaded_found[i].relevance, expected[i].relevance, query);
+            }
+        }
+        ASSERT_EQUAL(reloaded.FindTopDocuments("dog"s, DocumentStatus::BANNED).size(), 1);
+    }
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-3, std::ios::end);
+        file.put('x');
+    }
+    bool corrupted_rejected = false;
+    try {
+        SearchServer::LoadSnapshot(path);
+    }
+    catch (const std::invalid_argument&) {
+        corrupted_rejected = true;
+    }
+    ASSERT_HINT(corrupted_rejected, "Corrupted snapshot must be rejected"s);
+    std::remove(path.c_str());
+}
+
+// ,       ,   AddDocument
+void TestAddDocuments() {
+    const std::vector<std::string> texts = { "purple cat purple eyes"s, "small cowardly purple dog"s,
+        "big brave kind panda and orange cat"s, "orange fish"s, "purple fish and orange cat"s };
+    SearchServer expected("in the and"s);
+    SearchServer server("in the and"s);
+    expected.AddDocument(1, texts[0], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    server.AddDocument(1, texts[0], DocumentStatus::ACTUAL, { 1, 2, 3 });
+    std::vector<DocumentInput> documents;
+    for (int i = 1; i < static_cast<int>(texts.size()); ++i) {
+        const DocumentStatus status = i % 2 == 0 ? DocumentStatus::ACTUAL : DocumentStatus::BANNED;
+        expected.AddDocument(10 - i, texts[i], status, { i, 2 * i });
+        documents.push_back({ 10 - i, texts[i], status, { i, 2 * i } });
+    }
+    server.AddDocuments(documents);
+    ASSERT_EQUAL(server.GetDocumentCount(), expected.GetDocumentCount());
+    ASSERT(std::vector<int>(server.begin(), server.end()) == std::vector<int>(expected.begin(), expected.end()));
+    for (const int document_id : expected) {
+        ASSERT(server.GetWordFrequencies(document_id) == expected.GetWordFrequencies(document_id));
+    }
+    for (const std::string& query : { "purple cat"s, "orange -cat"s, "fish dog eyes"s }) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const auto found = server.FindTopDocuments(query, status);
+            const auto expected_found = expected.FindTopDocuments(query, status);
+            ASSERT_EQUAL_HINT(found.size(), expected_found.size(), query);
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL_HINT(found[i].id, expected_found[i].id, query);
+                ASSERT_EQUAL_HINT(found[i].relevance, expected_found[i].relevance, query);
+            }
+        }
+    }
+
+    //    
+    const std::vector<std::vector<DocumentInput>> invalid_batches = {
+        { { 20, "white cat", DocumentStatus::ACTUAL, {} }, { 20, "black cat", DocumentStatus::ACTUAL, {} } },
+        { { 21, "white cat", DocumentStatus::ACTUAL, {} }, { 1, "black cat", DocumentStatus::ACTUAL, {} } },
+        { { 22, "white cat", DocumentStatus::ACTUAL, {} }, { -1, "black cat", DocumentStatus::ACTUAL, {} } },
+        { { 23, "white cat", DocumentStatus::ACTUAL, {} }, { 24, "black \x12 cat", DocumentStatus::ACTUAL, {} } },
+    };
+    for (const auto& batch : invalid_batches) {
+        bool rejected = false;
+        try {
+            server.AddDocuments(batch);
+        }
+        catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        ASSERT(rejected);
+        ASSERT_EQUAL(server.GetDocumentCount(), texts.size());
+        ASSERT(server.FindTopDocuments("white"s).empty());
+    }
+}
+
+//         
+void TestDocumentStream() {
+    const std::vector<std::string> texts = { "purple cat purple eyes"s, "small cowardly purple dog"s, ""s,
+        "big brave kind panda and orange cat"s, "orange fish"s, "purple fish and orange cat"s };
+    SearchServer expected("in the and"s);
+    std::string input;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        expected.AddDocument(100 + static_cast<int>(i), texts[i], DocumentStatus::BANNED, { 1, 5 });
+        input += texts[i] + (i % 2 == 0 ? "\r\n"s : "\n"s);
+    }
+    input.pop_back(); //    
+
+    DocumentStreamOptions options;
+    options.first_document_id = 100;
+    options.status = DocumentStatus::BANNED;
+    options.ratings = { 1, 5 };
+    options.batch_size = 2;
+    options.queue_capacity = 1;
+    options.read_size = 7;
+    SearchServer server("in the and"s);
+    std::istringstream stream(input);
+    ASSERT_EQUAL(AddDocumentsFromStream(server, stream, options), texts.size());
+    ASSERT(std::vector<int>(server.begin(), server.end()) == std::vector<int>(expected.begin(), expected.end()));
+    for (const int document_id : expected) {
+        ASSERT(server.GetWordFrequencies(document_id) == expected.GetWordFrequencies(document_id));
+    }
+    ASSERT_EQUAL(server.FindTopDocuments("purple cat"s, DocumentStatus::BANNED).size(), 4);
+
+    const std::string path = "search_server_test_documents.txt"s;
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << input;
+    }
+    SearchServer file_server("in the and"s);
+    ASSERT_EQUAL(AddDocumentsFromFile(file_server, path, options), texts.size());
+    for (const int document_id : expected) {
+        ASSERT(file_server.GetWordFrequencies(document_id) == expected.GetWordFrequencies(document_id));
+    }
+    std::remove(path.c_str());
+
+    //    
+    std::istringstream duplicate_stream("white cat\nblack cat\n"s);
+    options.batch_size = 1;
+    bool rejected = false;
+    try {
+        AddDocumentsFromStream(server, duplicate_stream, options);
+    }
+    catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    ASSERT(rejected);
+    ASSERT_EQUAL(server.GetDocumentCount(), texts.size());
+}
+
+//    
+void TestQueryCache() {
+    SearchServer server("and in"s);
+    server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, { 8, -3 });
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, { 5, -12, 2, 1 });
+    ASSERT(server.GetQueryCache() == nullptr);
+    server.EnableQueryCache(2);
+    const QueryCache& cache = *server.GetQueryCache();
+
+    const auto first = server.FindTopDocuments("fluffy cat -dog"s);
+    ASSERT_EQUAL(cache.GetMissCount(), 1);
+    //            
+    const auto second = server.FindTopDocuments(std::execution::par, "cat and -dog fluffy cat"s);
+    ASSERT_EQUAL(cache.GetHitCount(), 1);
+    ASSERT_EQUAL(second.size(), first.size());
+    for (size_t i = 0; i < first.size(); ++i) {
+        ASSERT_EQUAL(second[i].id, first[i].id);
+        ASSERT_EQUAL(second[i].relevance, first[i].relevance);
+    }
+    //       
+    ASSERT(server.FindTopDocuments("fluffy cat -dog"s, DocumentStatus::BANNED).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat -dog"s, DocumentStatus::ACTUAL, 1).size(), 1);
+    ASSERT_EQUAL(cache.GetHitCount(), 1);
+
+    //      
+    server.FindTopDocuments("groomed dog"s, DocumentStatus::BANNED);
+    server.RemoveDocument(3);
+    ASSERT(server.FindTopDocuments("groomed dog"s, DocumentStatus::BANNED).empty());
+    server.AddDocument(4, "fluffy cat"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat -dog"s).size(), 3);
+
+    //      
+    const size_t misses = cache.GetMissCount();
+    server.FindTopDocuments("fluffy cat"s, [](int, DocumentStatus, int rating) { return rating > 0; });
+    ASSERT_EQUAL(cache.GetMissCount(), misses);
+}
+
+// ,         
+void TestFindTopDocumentsBatch() {
+    SearchServer server("and in on"s);
+    const std::vector<std::string> words = { "cat"s, "dog"s, "tail"s, "collar"s, "fluffy"s, "white"s, "eyes"s, "bird"s };
+    for (int id = 0; id < 60; ++id) {
+        std::string text;
+        for (int i = 0; i < 5; ++i) {
+            text += words[(id * 7 + i * i * 3 + id / 5) % words.size()] + " and "s;
+        }
+        server.AddDocument(id, text, id % 4 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id % 9 });
+    }
+    const std::vector<std::string> queries = { "fluffy cat"s, "cat -dog"s, "white collar and eyes"s, "unknown"s,
+        "fluffy cat"s, "bird bird tail -white"s, "in on"s, "eyes dog cat tail"s };
+    for (const RetrievalMode mode : { RetrievalMode::EXHAUSTIVE, RetrievalMode::MAX_SCORE }) {
+        server.SetRetrievalMode(mode);
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+            const auto results = server.FindTopDocumentsBatch(queries, status, 7);
+            ASSERT_EQUAL(results.size(), queries.size());
+            for (size_t i = 0; i < queries.size(); ++i) {
+                const auto expected = server.FindTopDocuments(queries[i], status, 7);
+                ASSERT_EQUAL_HINT(results[i].size(), expected.size(), queries[i]);
+                for (size_t j = 0; j < expected.size(); ++j) {
+                    ASSERT_EQUAL_HINT(results[i][j].id, expected[j].id, queries[i]);
+                    ASSERT_EQUAL_HINT(results[i][j].relevance, expected[j].relevance, queries[i]);
+                }
+            }
+        }
+    }
+    bool rejected = false;
+    try {
+        server.FindTopDocumentsBatch({ "cat"s, "--dog"s });
+    }
+    catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    ASSERT(rejected);
+}
+
+//     
+void TestProcessQueriesJoined() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
+    server.AddDocument(3, "big cat nasty hair"s, DocumentStatus::ACTUAL, { 1, 2, 8 });
+    server.AddDocument(4, "big dog cat Vladislav"s, DocumentStatus::ACTUAL, { 1, 3, 2 });
+    const std::vector<std::string> queries = { "nasty rat -not"s, "not very funny nasty pet"s, "curly hair"s, "parrot"s };
+    const auto results = ProcessQueries(server, queries);
+    const JoinedResults joined = ProcessQueriesJoined(server, queries);
+    ASSERT_EQUAL(joined.GetQueryCount(), queries.size());
+    std::vector<int> expected_ids;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto query_results = joined.GetQueryResults(i);
+        ASSERT_EQUAL(query_results.size(), results[i].size());
+        for (size_t j = 0; j < results[i].size(); ++j) {
+            ASSERT_EQUAL((query_results.begin() + j)->id, results[i][j].id);
+            expected_ids.push_back(results[i][j].id);
+        }
+    }
+    std::vector<int> ids;
+    for (const Document& document : joined) {
+        ids.push_back(document.id);
+    }
+    ASSERT(ids == expected_ids);
+    ASSERT_EQUAL(joined.size(), 7);
+    ASSERT(joined.GetQueryResults(3).size() == 0);
+
+    //         ,   
+    server.EnableQueryCache(16);
+    for (int pass = 0; pass < 2; ++pass) {
+        const JoinedResults cached = ProcessQueriesJoined(server, queries);
+        std::vector<int> cached_ids;
+        for (const Document& document : cached) {
+            cached_ids.push_back(document.id);
+        }
+        ASSERT(cached_ids == expected_ids);
+    }
+}
+
+//    ConcurrentSearchServer    
+void TestConcurrentSearchServer() {
+    ConcurrentSearchServer server("and in"s);
+    server.AddDocument(0, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, { 8, -3 });
+    const int document_count = 200;
+    std::atomic<bool> done = false;
+    std::atomic<bool> consistent = true;
+    //      :    ,
+    //      
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.emplace_back([&]() {
+            size_t last_count = 0;
+            while (!done) {
+                const size_t count = server.GetDocumentCount();
+                const auto found = server.FindTopDocuments("fluffy tail"s, DocumentStatus::ACTUAL, 1000);
+                for (const Document& document : found) {
+                    const auto [words, status] = server.MatchDocument("fluffy tail"s, document.id);
+                    const std::vector<std::string> expected_words = document.id == 1000
+                        ? std::vector<std::string>({ "fluffy"s }) : std::vector<std::string>({ "fluffy"s, "tail"s });
+                    if (words != expected_words) {
+                        consistent = false;
+                    }
+                }
+                if (count < last_count) {
+                    consistent = false;
+                }
+                last_count = count;
+            }
+            });
+    }
+    for (int id = 1; id <= document_count; ++id) {
+        server.AddDocument(id, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { id });
+    }
+    server.AddDocuments({ { 1000, "fluffy dog"s, DocumentStatus::ACTUAL, {} }, { 1001, "tail"s, DocumentStatus::BANNED, {} } });
+    done = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    ASSERT(consistent);
+    ASSERT_EQUAL(server.GetDocumentCount(), document_count + 3);
+
+    bool rejected = false;
+    try {
+        server.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, {});
+    }
+    catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    ASSERT(rejected);
+    server.RemoveDocument(0);
+    server.RemoveDocument(1000);
+    //        
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_EQUAL(server.GetDocumentCount(), document_count + 1);
+        ASSERT(server.FindTopDocuments("white cat"s).size() == MAX_RESULT_DOCUMENT_COUNT);
+        ASSERT(server.FindTopDocuments("collar dog"s).empty());
+        ASSERT_EQUAL(server.FindTopDocuments("tail"s, DocumentStatus::BANNED).size(), 1);
+        server.Update([](SearchServer&) {});
+    }
+
+    // ,       ,        
+    rejected = false;
+    try {
+        server.Update([](SearchServer& replica) {
+            replica.AddDocument(5000, "parrot"s, DocumentStatus::ACTUAL, {});
+            throw std::runtime_error("Update failed"s);
+            });
+    }
+    catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    ASSERT(rejected);
+    server.AddDocument(5001, "white parrot"s, DocumentStatus::ACTUAL, { 4 });
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_EQUAL(server.GetDocumentCount(), document_count + 2);
+        const auto found = server.FindTopDocuments("parrot"s);
+        ASSERT_EQUAL(found.size(), 1u);
+        ASSERT_EQUAL(found.front().id, 5001);
+        ASSERT(server.FindTopDocuments("white cat"s).size() == MAX_RESULT_DOCUMENT_COUNT);
+        ASSERT_EQUAL(server.FindTopDocuments("tail"s, DocumentStatus::BANNED).size(), 1);
+        server.Update([](SearchServer&) {});
+    }
+}
+
+//         
+void TestSplitIntoWordsView() {
+    //          ,      
+    const auto split_slow = [](std::string_view text) {
+        std::vector<std::string_view> words;
+        size_t begin = 0;
+        for (size_t i = 0; i <= text.size(); ++i) {
+            if (i == text.size() || text[i] == ' ') {
+                if (i > begin) {
+                    words.push_back(text.substr(begin, i - begin));
+                }
+                begin = i + 1;
+            }
+        }
+        return words;
+    };
+    const std::string alphabet = "ab  \xC0\xFF-"s;
+    std::vector<std::string_view> words;
+    for (size_t length = 0; length <= 70; ++length) {
+        for (size_t seed = 0; seed < 20; ++seed) {
+            std::string text;
+            for (size_t i = 0; i < length; ++i) {
+                text += alphabet[(i * i * 7 + seed * 13 + i * seed) % alphabet.size()];
+            }
+            ASSERT_HINT(SplitIntoWordsView(text) == split_slow(text), text);
+            ASSERT_HINT(SplitIntoValidWordsView(text, words), text);
+            ASSERT_HINT(words == split_slow(text), text);
+            ASSERT(!ContainsControlCharacters(text));
+            if (length > 0) {
+                text[(seed * 31) % length] = static_cast<char>(seed % 32);
+                ASSERT_HINT(!SplitIntoValidWordsView(text, words), text);
+                ASSERT(ContainsControlCharacters(text));
+            }
+        }
+    }
+}
+
+//   -
+void TestStopWordSet() {
+    ASSERT(!StopWordSet().Contains("and"s));
+    std::set<std::string, std::less<>> words;
+    for (int i = 0; i < 5000; ++i) {
+        words.insert("w"s + std::to_string(i * 2));
+    }
+    const StopWordSet stop_words(words);
+    ASSERT_EQUAL(stop_words.size(), words.size());
+    for (int i = 0; i < 10000; ++i) {
+        const std::string word = "w"s + std::to_string(i);
+        ASSERT_EQUAL_HINT(stop_words.Contains(word), i % 2 == 0, word);
+    }
+    ASSERT(!stop_words.Contains(""s));
+    ASSERT(!stop_words.Contains("w"s));
+    ASSERT(!stop_words.Contains("w00"s));
+
+    SearchServer server("in the"s);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {});
+    ASSERT(server.GetWordFrequencies(1).count("in"s) == 0);
+    ASSERT(server.FindTopDocuments("in the"s).empty());
+}
+
+//    : , ,     
+void TestCompressedPostingList() {
+    //  -   ;      
+    std::map<uint32_t, uint32_t> expected;
+    PostingList postings;
+    uint32_t seed = 12345;
+    const auto next_random = [&seed]() {
+        return NextRandom(seed) >> 8;
+    };
+    std::vector<Posting> batch;
+    uint32_t slot = 0;
+    for (int i = 0; i < 1000; ++i) {
+        slot += 1 + (i % 7 == 0 ? next_random() % 5000 : next_random() % 3);
+        batch.push_back({ slot, 1 + (i % 50 == 0 ? next_random() % 100000 : next_random() % 4) });
+        if (batch.size() == 37 || i == 999) {
+            postings.Merge(batch.data(), batch.data() + batch.size(), 1.0);
+            for (const Posting& posting : batch) {
+                expected[posting.slot] = posting.count;
+            }
+            batch.clear();
+        }
+    }
+    //       
+    for (uint32_t i = 0; i < 300; ++i) {
+        const uint32_t new_slot = next_random() % slot;
+        if (expected.count(new_slot) == 0) {
+            const Posting posting{ new_slot, i + 1 };
+            postings.Merge(&posting, &posting + 1, 2.0);
+            expected[new_slot] = i + 1;
+        }
+    }
+    //    :   ,    
+    std::set<uint32_t> middle_slots;
+    while (middle_slots.size() < 400) {
+        const uint32_t new_slot = next_random() % slot;
+        if (expected.count(new_slot) == 0) {
+            middle_slots.insert(new_slot);
+        }
+    }
+    batch.clear();
+    for (const uint32_t middle_slot : middle_slots) {
+        batch.push_back({ middle_slot, 3 });
+        expected[middle_slot] = 3;
+    }
+    postings.Merge(batch.data(), batch.data() + batch.size(), 1.5);
+    //    ,      
+    const auto check_layout = [&postings]() {
+        ASSERT(postings.IsConsistent());
+        size_t used_words = 0;
+        for (const PostingBlock& block : postings.GetBlocks()) {
+            ASSERT(block.size <= PostingList::BLOCK_SIZE);
+            used_words += (static_cast<size_t>(block.size) * (block.slot_bits + block.count_bits) + 31) / 32;
+        }
+        ASSERT(postings.GetData().size() <= 2 * used_words + 2 * PostingList::BLOCK_SIZE);
+    };
+    check_layout();
+    for (int i = 0; i < 200; ++i) {
+        auto it = expected.begin();
+        std::advance(it, next_random() % expected.size());
+        postings.Erase(it->first);
+        expected.erase(it);
+    }
+    check_layout();
+    postings.Erase(slot + 1);
+    ASSERT_EQUAL(postings.GetMaxTermFreq(), 2.0);
+
+    const auto check = [&expected](const PostingList& list) {
+        ASSERT_EQUAL(list.size(), expected.size());
+        std::vector<std::pair<uint32_t, uint32_t>> actual;
+        list.ForEach([&actual](uint32_t slot, uint32_t count) { actual.emplace_back(slot, count); });
+        using Entries = std::vector<std::pair<uint32_t, uint32_t>>;
+        ASSERT(actual == Entries(expected.begin(), expected.end()));
+
+        const uint32_t begin_slot = expected.begin()->first + 1000;
+        const uint32_t end_slot = begin_slot + 20000;
+        actual.clear();
+        list.ForEach(begin_slot, end_slot, [&actual](uint32_t slot, uint32_t count) { actual.emplace_back(slot, count); });
+        ASSERT(actual == Entries(expected.lower_bound(begin_slot), expected.lower_bound(end_slot)));
+
+        PostingList::Cursor cursor = list.GetCursor();
+        for (uint32_t target = 0; target < expected.rbegin()->first + 10; target += 777) {
+            cursor.Seek(target);
+            const auto it = expected.lower_bound(target);
+            ASSERT_EQUAL(cursor.IsEnd(), it == expected.end());
+            if (!cursor.IsEnd()) {
+                ASSERT_EQUAL(cursor.GetSlot(), it->first);
+                ASSERT_EQUAL(cursor.GetCount(), it->second);
+                ASSERT_EQUAL(list.Contains(target), it->first == target);
+            }
+        }
+        for (const auto [slot, count] : expected) {
+            ASSERT(list.Contains(slot));
+            ASSERT(!list.Contains(slot + 1) || expected.count(slot + 1) != 0);
+        }
+    };
+    check(postings);
+    // ,     ,    
+    const PostingList borrowed(
+        FlatArray<PostingBlock>::Borrow(postings.GetBlocks().data(), postings.GetBlocks().size()),
+        FlatArray<uint32_t>::Borrow(postings.GetData().data(), postings.GetData().size()), postings.GetMaxTermFreq());
+    ASSERT(borrowed.IsConsistent());
+    check(borrowed);
+
+    while (!expected.empty()) {
+        postings.Erase(expected.begin()->first);
+        expected.erase(expected.begin());
+    }
+    ASSERT(postings.empty());
+    ASSERT(postings.GetBlocks().empty() && postings.GetData().empty());
+    ASSERT(postings.GetCursor().IsEnd());
+
+    //         
+    SearchServer server(""s);
+    server.AddDocument(1, "cat cat dog cat"s, DocumentStatus::ACTUAL, {});
+    ASSERT(std::abs(server.GetWordFrequencies(1).at("cat"s) - 0.75) < ALLOWABLE_ERROR);
+    ASSERT(std::abs(server.GetWordFrequencies(1).at("dog"s) - 0.25) < ALLOWABLE_ERROR);
+}
+
+// ,    -       
+void TestMinusWordsExclusion() {
+    //  ,      ; - collar    ,
+    // parrot -   ,       ,  
+    SearchServer server("and"s);
+    const int document_count = 5000;
+    for (int id = 0; id < document_count; ++id) {
+        std::string text = "cat"s;
+        if (id % 2 == 0) {
+            text += " dog"s;
+        }
+        if (id % 3 == 0) {
+            text += " collar"s;
+        }
+        if (id % 1000 == 7) {
+            text += " parrot"s;
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 10 });
+    }
+    for (const std::string& query : { "cat dog -collar"s, "cat -collar -dog"s, "dog -cat"s, "dog -unknown"s,
+        "cat -parrot"s, "cat dog -parrot -unknown"s, "cat -parrot -collar"s }) {
+        const auto seq_documents = server.FindTopDocuments(std::execution::seq, query,
+            [](int, DocumentStatus, int) { return true; });
+        const auto par_documents = server.FindTopDocuments(std::execution::par, query,
+            [](int, DocumentStatus, int) { return true; });
+        ASSERT_EQUAL_HINT(seq_documents.size(), par_documents.size(), query);
+        for (size_t i = 0; i < seq_documents.size(); ++i) {
+            ASSERT_EQUAL_HINT(seq_documents[i].id, par_documents[i].id, query);
+            ASSERT(std::abs(seq_documents[i].relevance - par_documents[i].relevance) < ALLOWABLE_ERROR);
+        }
+        for (const Document& document : seq_documents) {
+            const auto [words, status] = server.MatchDocument(query, document.id);
+            ASSERT_HINT(!words.empty(), query);
+        }
+    }
+    ASSERT(server.FindTopDocuments("dog -cat"s).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("dog -unknown"s).size(), MAX_RESULT_DOCUMENT_COUNT);
+    for (const Document& document : server.FindTopDocuments(std::execution::par, "cat dog -collar"s)) {
+        ASSERT(document.id % 3 != 0);
+    }
+    for (const auto& documents : { server.FindTopDocuments(std::execution::seq, "cat -parrot"s, DocumentStatus::ACTUAL, document_count),
+        server.FindTopDocuments(std::execution::par, "cat -parrot"s, DocumentStatus::ACTUAL, document_count) }) {
+        ASSERT_EQUAL(documents.size(), static_cast<size_t>(document_count - 5));
+        for (const Document& document : documents) {
+            ASSERT(document.id % 1000 != 7);
+        }
+    }
+    //             -
+    server.RemoveDocument(0);
+    server.SetRetrievalMode(RetrievalMode::MAX_SCORE);
+    for (const Document& document : server.FindTopDocuments("cat dog -collar"s)) {
+        ASSERT(document.id % 3 != 0);
+    }
+}
+
+// ,        ,     
+void TestStatusFilter() {
+    SearchServer server("and"s);
+    const std::vector<DocumentStatus> statuses = { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT,
+        DocumentStatus::BANNED, DocumentStatus::REMOVED };
+    for (int id = 0; id < 3000; ++id) {
+        server.AddDocument(id, id % 5 == 0 ? "cat and dog"s : "cat"s, statuses[id % 7 % 4], { id % 11 });
+    }
+    //       
+    for (int id = 0; id < 3000; id += 3) {
+        server.RemoveDocument(id);
+    }
+    for (int id = 3000; id < 3500; ++id) {
+        server.AddDocument(id, "cat dog"s, statuses[id % 4], { id % 11 });
+    }
+    for (const DocumentStatus status : statuses) {
+        const auto by_predicate = [status](int, DocumentStatus document_status, int) { return document_status == status; };
+        for (const std::string& query : { "cat"s, "dog -cat"s, "cat dog"s, "dog"s }) {
+            const auto expected = server.FindTopDocuments(std::execution::seq, query, by_predicate, 5000);
+            for (const auto& found : { server.FindTopDocuments(std::execution::seq, query, status, 5000),
+                server.FindTopDocuments(std::execution::par, query, status, 5000) }) {
+                ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+                for (size_t i = 0; i < found.size(); ++i) {
+                    ASSERT_EQUAL_HINT(found[i].relevance, expected[i].relevance, query);
+                    ASSERT_EQUAL_HINT(found[i].rating, expected[i].rating, query);
+                }
+            }
+            for (const Document& document : server.FindTopDocuments(query, status, 5000)) {
+                ASSERT(std::get<1>(server.MatchDocument(query, document.id)) == status);
+            }
+        }
+    }
+    ASSERT(server.FindTopDocuments("cat"s, static_cast<DocumentStatus>(DOCUMENT_STATUS_COUNT)).empty());
+}
+
+// ,   IDF      
+void TestIdfCache() {
+    //           
+    SearchServer server(""s);
+    server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {});
+    server.AddDocument(2, "black dog"s, DocumentStatus::ACTUAL, {});
+    server.AddDocument(3, "white dog"s, DocumentStatus::ACTUAL, {});
+    ASSERT(std::abs(server.FindTopDocuments("cat"s).at(0).relevance - std::log(3.0) / 2) < ALLOWABLE_ERROR);
+    server.AddDocument(4, "grey cat"s, DocumentStatus::ACTUAL, {});
+    ASSERT(std::abs(server.FindTopDocuments("cat"s).at(0).relevance - std::log(2.0) / 2) < ALLOWABLE_ERROR);
+    server.RemoveDocument(4);
+    server.RemoveDocument(2);
+    //  black   ,   id    
+    server.AddDocument(5, "red parrot"s, DocumentStatus::ACTUAL, {});
+
+    SearchServer rebuilt(""s);
+    rebuilt.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {});
+    rebuilt.AddDocument(3, "white dog"s, DocumentStatus::ACTUAL, {});
+    rebuilt.AddDocument(5, "red parrot"s, DocumentStatus::ACTUAL, {});
+    for (const std::string& query : { "cat"s, "white dog"s, "parrot -cat"s, "black red"s }) {
+        for (const auto& found : { server.FindTopDocuments(query), server.FindTopDocuments(std::execution::par, query) }) {
+            const auto expected = rebuilt.FindTopDocuments(query);
+            ASSERT_EQUAL_HINT(found.size(), expected.size(), query);
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL_HINT(found[i].id, expected[i].id, query);
+                ASSERT_EQUAL_HINT(found[i].relevance, expected[i].relevance, query);
+            }
+        }
+    }
+}
+
+//      
+void TestStageMetrics() {
+    const size_t histogram = RegisterLatencyHistogram("test.latency"s);
+    ASSERT_EQUAL(RegisterLatencyHistogram("test.latency"s), histogram);
+    const size_t counter = RegisterCounter("test.counter"s);
+    //   1   1     ,     
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([histogram, counter, i]() {
+            for (uint64_t value = 1; value <= 1000; ++value) {
+                if (value % 4 == static_cast<uint64_t>(i)) {
+                    RecordLatency(histogram, value * 1000);
+                    AddToCounter(counter, 2);
+                }
+            }
+            });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const MetricsSnapshot snapshot = GetMetricsSnapshot();
+    const auto latency = std::find_if(snapshot.histograms.begin(), snapshot.histograms.end(),
+        [](const LatencyHistogramSnapshot& item) { return item.name == "test.latency"s; });
+    ASSERT(latency != snapshot.histograms.end());
+    ASSERT_EQUAL(latency->count, 1000u);
+    ASSERT_EQUAL(latency->max_ns, 1000000u);
+    ASSERT(std::abs(latency->GetMean() - 500500.0) < ALLOWABLE_ERROR);
+    for (const double percentile : { 50.0, 99.0, 99.9 }) {
+        const double expected = percentile * 10000.0;
+        const double actual = static_cast<double>(latency->GetValueAtPercentile(percentile));
+        ASSERT_HINT(actual >= expected && actual <= expected * (1.0 + 1.0 / 32), std::to_string(percentile));
+    }
+    ASSERT_EQUAL(latency->GetValueAtPercentile(100.0), 1000000u);
+    const auto counted = std::find_if(snapshot.counters.begin(), snapshot.counters.end(),
+        [](const CounterSnapshot& item) { return item.name == "test.counter"s; });
+    ASSERT(counted != snapshot.counters.end() && counted->value == 2000u);
+
+#ifndef SEARCH_SERVER_DISABLE_METRICS
+    SearchServer server(""s);
+    server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, {});
+    server.FindTopDocuments("cat"s);
+    server.MatchDocument("cat"s, 1);
+    std::ostringstream out;
+    PrintMetrics(out);
+    for (const std::string& stage : { "search_server.add_document: count="s, "search_server.parse_query: count="s,
+        "search_server.find_top_documents.exhaustive.seq: count="s, "search_server.select_top_documents.drain: count="s,
+        "search_server.select_top_documents: count="s,
+        "search_server.match_document.seq: count="s, "test.latency: count=1000 "s }) {
+        ASSERT_HINT(out.str().find(stage) != std::string::npos, stage);
+    }
+    //          MaxScore
+    const auto get_stage_count = [](const std::string& name) -> uint64_t {
+        const MetricsSnapshot metrics = GetMetricsSnapshot();
+        const auto stage = std::find_if(metrics.histograms.begin(), metrics.histograms.end(),
+            [&name](const LatencyHistogramSnapshot& item) { return item.name == name; });
+        return stage == metrics.histograms.end() ? 0 : stage->count;
+    };
+    const uint64_t selections = get_stage_count("search_server.select_top_documents"s);
+    server.SetRetrievalMode(RetrievalMode::MAX_SCORE);
+    server.FindTopDocuments("white cat"s);
+    ASSERT(get_stage_count("search_server.find_top_documents.max_score"s) > 0);
+    ASSERT_EQUAL(get_stage_count("search_server.select_top_documents"s), selections + 1);
+#endif
+}
+
+//             
+void TestRequestStatistics() {
+    using Clock = RequestStatistics::Clock;
+    {
+        RequestStatistics statistics({ std::chrono::seconds(60), std::chrono::seconds(10) });
+        const Clock::time_point origin = Clock::time_point{} + std::chrono::hours(1);
+        for (int second = 0; second < 60; ++second) {
+            statistics.Record(origin + std::chrono::seconds(second), std::chrono::microseconds(second + 1), second % 4 == 0);
+        }
+        //       
+        statistics.Record(origin - std::chrono::seconds(2), std::chrono::seconds(1), true);
+
+        const auto result = statistics.GetStatistics(origin + std::chrono::milliseconds(59500));
+        ASSERT_EQUAL(result.size(), 2);
+        ASSERT_EQUAL(result[0].window.count(), 60);
+        ASSERT_EQUAL(result[0].requests, 60);
+        ASSERT_EQUAL(result[0].no_result_requests, 15);
+        ASSERT(std::abs(result[0].no_result_rate - 0.25) < 1e-9);
+        ASSERT(std::abs(result[0].queries_per_second - 1.0) < 1e-9);
+        //       1/8
+        ASSERT(result[0].latency_p50_ns >= 30000 && result[0].latency_p50_ns <= 30000 * 9 / 8);
+        ASSERT(result[0].latency_p99_ns >= 60000 && result[0].latency_p99_ns <= 60000 * 9 / 8);
+
+        ASSERT_EQUAL(result[1].window.count(), 10);
+        ASSERT_EQUAL(result[1].requests, 10);
+        ASSERT_EQUAL(result[1].no_result_requests, 2);
+        ASSERT(result[1].latency_p50_ns >= 55000 && result[1].latency_p50_ns <= 55000 * 9 / 8);
+        ASSERT(result[1].latency_p90_ns >= 59000 && result[1].latency_p90_ns <= 59000 * 9 / 8);
+
+        //          
+        const Clock::time_point later = origin + std::chrono::minutes(5);
+        statistics.Record(later, std::chrono::microseconds(1), false);
+        const auto later_result = statistics.GetStatistics(later);
+        ASSERT_EQUAL(later_result[0].requests, 1);
+        ASSERT_EQUAL(later_result[1].requests, 1);
+        ASSERT_EQUAL(later_result[1].no_result_requests, 0);
+        ASSERT_EQUAL(statistics.GetStatistics(later + std::chrono::minutes(2))[0].requests, 0);
+    }
+    for (const std::vector<std::chrono::seconds>& windows : { std::vector<std::chrono::seconds>{},
+        std::vector<std::chrono::seconds>{ std::chrono::seconds(0) } }) {
+        bool rejected = false;
+        try {
+            RequestStatistics statistics(windows);
+        }
+        catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        ASSERT_HINT(rejected, "Invalid windows must be rejected"s);
+    }
+    {
+        SearchServer server("in the and"s);
+        server.AddDocument(42, "purple cat purple eyes"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
+        RequestQueue queue(server);
+        const std::vector<std::string> empty_queries(3000, "empty request"s);
+        std::for_each(std::execution::par, empty_queries.begin(), empty_queries.end(), [&queue](const std::string& query) {
+            queue.AddFindRequest(query);
+        });
+        ASSERT_EQUAL(queue.GetNoResultRequests(), RequestQueue::REQUEST_WINDOW);
+        for (int i = 0; i < RequestQueue::REQUEST_WINDOW - 100; ++i) {
+            queue.AddFindRequest("purple cat"s);
+        }
+        ASSERT_EQUAL(queue.GetNoResultRequests(), 100);
+
+        const auto result = queue.GetStatistics();
+        ASSERT_EQUAL(result.size(), 3);
+        ASSERT_EQUAL(result[0].requests, 3000 + RequestQueue::REQUEST_WINDOW - 100);
+        ASSERT_EQUAL(result[0].no_result_requests, 3000);
+        ASSERT(result[0].latency_p50_ns > 0);
+    }
+}
+
+//        
+void TestNearDuplicates() {
+    const std::string base = "alpha beta gamma delta epsilon zeta eta theta iota kappa lambda mu nu xi omicron pi rho sigma tau upsilon"s;
+    SearchServer server("and the"s);
+    server.AddDocument(1, base, DocumentStatus::ACTUAL, { 1 });
+    //   :   19 / 21
+    server.AddDocument(2, "alpha beta gamma delta epsilon zeta eta theta iota kappa lambda mu nu xi omicron pi rho sigma tau phi"s,
+        DocumentStatus::ACTUAL, { 1 });
+    //      ,    -:   1
+    server.AddDocument(3, "upsilon tau sigma rho pi omicron xi nu mu lambda kappa iota theta eta zeta epsilon delta gamma beta alpha and alpha"s,
+        DocumentStatus::ACTUAL, { 1 });
+    //      :   10 / 30
+    server.AddDocument(4, "alpha beta gamma delta epsilon zeta eta theta iota kappa one two three four five six seven eight nine ten"s,
+        DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(5, "white cat with fashionable collar"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(6, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(7, "fluffy tail and cat"s, DocumentStatus::ACTUAL, { 1 });
+    for (int id = 100; id < 400; ++id) {
+        server.AddDocument(id, "document number "s + std::to_string(id) + " word"s + std::to_string(id % 17),
+            DocumentStatus::ACTUAL, { 1 });
+    }
+
+    const auto clusters = FindNearDuplicates(server);
+    ASSERT_EQUAL(clusters.size(), 2);
+    ASSERT(clusters[0].document_ids == std::vector<int>({ 1, 2, 3 }));
+    ASSERT(clusters[1].document_ids == std::vector<int>({ 6, 7 }));
+
+    //         
+    NearDuplicateOptions strict;
+    strict.jaccard_threshold = 0.95;
+    const auto strict_clusters = FindNearDuplicates(server, strict);
+    ASSERT_EQUAL(strict_clusters.size(), 2);
+    ASSERT(strict_clusters[0].document_ids == std::vector<int>({ 1, 3 }));
+
+    ASSERT_EQUAL(RemoveNearDuplicates(server).size(), 2);
+    ASSERT_EQUAL(server.GetDocumentCount(), 304);
+    ASSERT(server.GetTermIds(2).empty() && server.GetTermIds(3).empty() && server.GetTermIds(7).empty());
+    ASSERT(!server.GetTermIds(1).empty() && !server.GetTermIds(6).empty());
+    ASSERT(FindNearDuplicates(server).empty());
+
+    for (const double threshold : { 0.0, 1.5 }) {
+        NearDuplicateOptions invalid;
+        invalid.jaccard_threshold = threshold;
+        bool rejected = false;
+        try {
+            FindNearDuplicates(server, invalid);
+        }
+        catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        ASSERT_HINT(rejected, "Invalid threshold must be rejected"s);
+    }
+
+    //         ,    
+    //      id; ,      ,     
+    SearchServer pairs_server("and"s);
+    const int pair_count = 300;
+    uint32_t state = 1;
+    for (int k = 0; k < pair_count; ++k) {
+        std::string text;
+        for (int w = 0; w < 8; ++w) {
+            text += "w"s + std::to_string((NextRandom(state) >> 16) % 400) + " "s;
+        }
+        pairs_server.AddDocument(k, text + "x"s + std::to_string(k), DocumentStatus::ACTUAL, { 1 });
+        pairs_server.AddDocument(2 * pair_count - 1 - k, text + "y"s + std::to_string(k), DocumentStatus::ACTUAL, { 1 });
+    }
+    NearDuplicateOptions single_row;
+    single_row.jaccard_threshold = 0.7;
+    single_row.bands = 8;
+    single_row.rows_per_band = 1;
+    std::vector<int> document_clusters(2 * pair_count, -1);
+    const auto pair_clusters = FindNearDuplicates(pairs_server, single_row);
+    for (size_t i = 0; i < pair_clusters.size(); ++i) {
+        for (const int id : pair_clusters[i].document_ids) {
+            document_clusters[id] = static_cast<int>(i);
+        }
+    }
+    for (int k = 0; k < pair_count; ++k) {
+        ASSERT_HINT(document_clusters[k] != -1 && document_clusters[k] == document_clusters[2 * pair_count - 1 - k],
+            std::to_string(k));
+    }
+
+    // :     9 / 11,  - 8 / 12.     ,
+    //    :     
+    SearchServer chain_server("and"s);
+    const std::string words = "one two three four five six seven eight nine ten eleven twelve"s;
+    const std::vector<std::string> chain_words = SplitIntoWords(words);
+    for (int id = 0; id < 3; ++id) {
+        std::string text;
+        for (int w = id; w < id + 10; ++w) {
+            text += chain_words[w] + " "s;
+        }
+        chain_server.AddDocument(id, text, DocumentStatus::ACTUAL, { 1 });
+    }
+    const auto chain_clusters = RemoveNearDuplicates(chain_server);
+    ASSERT_EQUAL(chain_clusters.size(), 1u);
+    ASSERT(chain_clusters[0].document_ids == std::vector<int>({ 0, 1, 2 }));
+    ASSERT(std::vector<int>(chain_server.begin(), chain_server.end()) == std::vector<int>({ 0, 2 }));
+}
+
+// ,         
+void TestSearchServerMove() {
+    static_assert(!std::is_copy_constructible_v<SearchServer>);
+    static_assert(std::is_move_constructible_v<SearchServer> && std::is_move_assignable_v<SearchServer>);
+    SearchServer source("in the"s);
+    source.AddDocument(1, "white cat in the collar"s, DocumentStatus::ACTUAL, { 8, -3 });
+    source.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    source.EnableQueryCache(4);
+    const auto [words, status] = source.MatchDocument("fluffy cat"s, 2);
+    //     ,         
+    SearchServer server(std::move(source));
+    ASSERT_EQUAL(words.size(), 2u);
+    ASSERT_EQUAL(words[0], "cat"s);
+    ASSERT_EQUAL(words[1], "fluffy"s);
+    ASSERT(server.GetQueryCache() != nullptr);
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy cat"s).size(), 2u);
+    ASSERT_EQUAL(server.FindTopDocuments("in the"s).size(), 0u);
+
+    SearchServer other("and"s);
+    other = std::move(server);
+    ASSERT_EQUAL(other.GetDocumentCount(), 2u);
+    ASSERT_EQUAL(other.FindTopDocuments("collar"s).front().id, 1);
+}
+
+// ,   MatchDocument      
+void TestMatchedWordsLifetime() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "grey cat and fox"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(2, "white cat"s, DocumentStatus::ACTUAL, { 2 });
+    const auto [words, status] = server.MatchDocument("cat fox"s, 1);
+    ASSERT_EQUAL(words.size(), 2u);
+    //  1      fox,       
+    server.RemoveDocument(1);
+    for (int id = 3; id < 100; ++id) {
+        server.AddDocument(id, "ox"s + std::to_string(id % 10) + " rat"s, DocumentStatus::ACTUAL, { 3 });
+    }
+    server.AddDocument(100, "bat cow"s, DocumentStatus::ACTUAL, { 3 });
+    ASSERT_EQUAL(words[0], "cat"s);
+    ASSERT_EQUAL(words[1], "fox"s);
+    ASSERT(std::get<0>(server.MatchDocument("cat"s, 2)).front().data() == words[0].data());
+    //    ,  , CompactTerms   
+    ASSERT(!server.CompactTerms());
+    for (int id = 3; id <= 100; ++id) {
+        server.RemoveDocument(id);
+    }
+    ASSERT(server.CompactTerms());
+    const auto [compacted_words, compacted_status] = server.MatchDocument("cat fox rat"s, 2);
+    ASSERT_EQUAL(compacted_words.size(), 1u);
+    ASSERT_EQUAL(compacted_words[0], "cat"s);
+    ASSERT(server.FindTopDocuments("rat"s).empty());
+    server.AddDocument(101, "red fox"s, DocumentStatus::ACTUAL, { 4 });
+    ASSERT_EQUAL(server.FindTopDocuments("fox cat"s).size(), 2u);
+    ASSERT_EQUAL(server.GetWordFrequencies(2).count("white"s), 1u);
+}
+
 //  TestSearchServer      
 void TestSearchServer() {
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
@@ -357,6 +1555,28 @@ void TestSearchServer() {
     RUN_TEST(TestPaginate);
     RUN_TEST(TestRemoveDocument);
     RUN_TEST(TestGetWordFrequencies);
-    //RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestRemoveDuplicates);
     RUN_TEST(TestRequestQueue);
+    RUN_TEST(TestTopDocumentsCount);
+    RUN_TEST(TestMaxScoreRetrieval);
+    RUN_TEST(TestTextArena);
+    RUN_TEST(TestParallelFindTopDocuments);
+    RUN_TEST(TestSnapshot);
+    RUN_TEST(TestAddDocuments);
+    RUN_TEST(TestDocumentStream);
+    RUN_TEST(TestQueryCache);
+    RUN_TEST(TestFindTopDocumentsBatch);
+    RUN_TEST(TestProcessQueriesJoined);
+    RUN_TEST(TestConcurrentSearchServer);
+    RUN_TEST(TestSplitIntoWordsView);
+    RUN_TEST(TestStopWordSet);
+    RUN_TEST(TestCompressedPostingList);
+    RUN_TEST(TestMinusWordsExclusion);
+    RUN_TEST(TestStatusFilter);
+    RUN_TEST(TestIdfCache);
+    RUN_TEST(TestStageMetrics);
+    RUN_TEST(TestRequestStatistics);
+    RUN_TEST(TestNearDuplicates);
+    RUN_TEST(TestSearchServerMove);
+    RUN_TEST(TestMatchedWordsLifetime);
 }
\ No newline at end of file
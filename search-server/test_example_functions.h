@@ -1,4 +1,9 @@
 #pragma once
+#include <sstream>
+#include <thread>
+#include "concurrent_search_server.h"
+#include "document_stream.h"
+#include "near_duplicates.h"
 #include "paginator.h"
 #include "search_server.h"
 #include "remove_duplicates.h"
@@ -15,6 +20,9 @@ void AssertImpl(bool value, const std::string& expr_str, const std::string& file
 template <typename T>
 void RunTestImpl(const T&, const std::string& t_str);
 
+//       :  seed    
+uint32_t NextRandom(uint32_t& seed);
+
 //  ,     -   
 void TestExcludeStopWordsFromAddedDocumentContent();
 
@@ -58,6 +66,72 @@ void TestRemoveDuplicates();
 //     
 void TestRequestQueue();
 
+// ,      
+void TestTopDocumentsCount();
+
+// ,     MaxScore    ,    
+void TestMaxScoreRetrieval();
+
+//         
+void TestTextArena();
+
+// ,       ,   
+void TestParallelFindTopDocuments();
+
+//         
+void TestSnapshot();
+
+// ,       ,   AddDocument
+void TestAddDocuments();
+
+//         
+void TestDocumentStream();
+
+//    
+void TestQueryCache();
+
+// ,         
+void TestFindTopDocumentsBatch();
+
+//     
+void TestProcessQueriesJoined();
+
+//    ConcurrentSearchServer    
+void TestConcurrentSearchServer();
+
+//         
+void TestSplitIntoWordsView();
+
+//   -
+void TestStopWordSet();
+
+//    : , ,     
+void TestCompressedPostingList();
+
+// ,    -       
+void TestMinusWordsExclusion();
+
+// ,        ,     
+void TestStatusFilter();
+
+// ,   IDF      
+void TestIdfCache();
+
+//      
+void TestStageMetrics();
+
+//             
+void TestRequestStatistics();
+
+//        
+void TestNearDuplicates();
+
+// ,         
+void TestSearchServerMove();
+
+// ,   MatchDocument  ,     
+void TestMatchedWordsLifetime();
+
 //  TestSearchServer      
 void TestSearchServer();
 
@@ -80,6 +154,7 @@ void AssertEqualImpl(const T& t, const U& u, const std::string& t_str, const std
 
 
 template <typename T>
-void RunTestImpl(const T&, const std::string& t_str) {
+void RunTestImpl(const T& func, const std::string& t_str) {
+    func();
     std::cerr << t_str << " OK"s << std::endl;
 }
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "text_arena.h"
+#include <cstring>
+
+TextArena::TextArena(size_t slab_size) :
+        slab_size_(slab_size) {
+    }
+
+std::string_view TextArena::Store(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    size_t slab_id = current_slab_;
+    if (text.size() > slab_size_) {
+        // Длинная строка получает собственный блок, текущий блок продолжает заполняться
+        slab_id = AllocateSlab(text.size());
+    }
+    else if (slab_id == SIZE_MAX || slabs_[slab_id].capacity - slabs_[slab_id].used < text.size()) {
+        current_slab_ = slab_id = AllocateSlab(slab_size_);
+    }
+    Slab& slab = slabs_[slab_id];
+    char* place = slab.data.get() + slab.used;
+    std::memcpy(place, text.data(), text.size());
+    slab.used += text.size();
+    stored_bytes_ += text.size();
+    live_bytes_ += text.size();
+    return { place, text.size() };
+}
+
+void TextArena::Release(std::string_view text) {
+    if (!text.empty() && FindSlab(text) != SIZE_MAX) {
+        live_bytes_ -= text.size();
+    }
+}
+
+bool TextArena::Owns(std::string_view text) const {
+    return !text.empty() && FindSlab(text) != SIZE_MAX;
+}
+
+size_t TextArena::GetAllocatedBytes() const {
+    return allocated_bytes_;
+}
+
+size_t TextArena::GetLiveBytes() const {
+    return live_bytes_;
+}
+
+size_t TextArena::GetReleasedBytes() const {
+    return stored_bytes_ - live_bytes_;
+}
+
+size_t TextArena::AllocateSlab(size_t capacity) {
+    Slab& slab = slabs_.emplace_back();
+    slab.data = std::make_unique<char[]>(capacity);
+    slab.capacity = capacity;
+    slab_by_address_[slab.data.get()] = slabs_.size() - 1;
+    allocated_bytes_ += capacity;
+    return slabs_.size() - 1;
+}
+
+size_t TextArena::FindSlab(std::string_view text) const {
+    auto it = slab_by_address_.upper_bound(text.data());
+    if (it == slab_by_address_.begin()) {
+        return SIZE_MAX;
+    }
+    --it;
+    const Slab& slab = slabs_[it->second];
+    const size_t offset = static_cast<size_t>(text.data() - slab.data.get());
+    return offset + text.size() > slab.used ? SIZE_MAX : it->second;
+}
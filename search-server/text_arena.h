@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Хранилище строк в крупных блоках (slab) памяти.
+// Строки никогда не перемещаются и не перезаписываются, поэтому выданные string_view действительны, пока живо
+// хранилище, в том числе после Release: Release только учитывает байты строки как освобождённые.
+// Память освобождённых строк возвращается переносом живых строк в новое хранилище (см. TermDictionary::Compact)
+class TextArena {
+public:
+    static constexpr size_t DEFAULT_SLAB_SIZE = 64 * 1024;
+
+    explicit TextArena(size_t slab_size = DEFAULT_SLAB_SIZE);
+
+    TextArena(const TextArena&) = delete;
+    TextArena& operator=(const TextArena&) = delete;
+    TextArena(TextArena&&) = default;
+    TextArena& operator=(TextArena&&) = default;
+
+    std::string_view Store(std::string_view text);
+
+    // Строки, выделенные не этим хранилищем, игнорируются
+    void Release(std::string_view text);
+
+    bool Owns(std::string_view text) const;
+
+    size_t GetAllocatedBytes() const;
+
+    size_t GetLiveBytes() const;
+
+    // Байты строк, освобождённых Release, но ещё занимающих память
+    size_t GetReleasedBytes() const;
+private:
+    struct Slab {
+        std::unique_ptr<char[]> data;
+        size_t capacity = 0;
+        size_t used = 0;
+    };
+
+    size_t slab_size_;
+    std::vector<Slab> slabs_;
+    size_t current_slab_ = SIZE_MAX;
+    std::map<const char*, size_t> slab_by_address_;
+    size_t allocated_bytes_ = 0;
+    size_t stored_bytes_ = 0;
+    size_t live_bytes_ = 0;
+
+    size_t AllocateSlab(size_t capacity);
+
+    // Номер блока, в котором целиком лежит text, или SIZE_MAX
+    size_t FindSlab(std::string_view text) const;
+};